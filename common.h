@@ -10,12 +10,12 @@
 
 #define DEBUG
 #ifdef DEBUG
-#define DEBUG_MSG(fmt, args...) printf("%s(): \t"fmt, __FUNCTION__, ##args)
+#define DEBUG_MSG(fmt, args...) printf("%s(): \t" fmt, __FUNCTION__, ##args)
 #else
 #define DEBUG_MSG(fmt, args...)
 #endif
 
-#define ERR_MSG(fmt, args...) printf("ERROR in %d:%s(): "fmt, __LINE__, __FUNCTION__, ##args)
+#define ERR_MSG(fmt, args...) printf("ERROR in %d:%s(): " fmt, __LINE__, __FUNCTION__, ##args)
 
 #define EXIT_ERROR(v, fmt, args...) \
     do                              \
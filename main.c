@@ -7,6 +7,7 @@
 
 #include "mapreduce.h"
 #include "usr_functions.h"
+#include "regex_dfa.h"
 
 int str_is_decimal_num(char * str)
 {
@@ -51,15 +52,41 @@ int is_regular_file(char * file_path)
     return 0;
 }
 
+/* "-" (stdin), FIFOs and character devices are consumed by mapreduce() in streaming mode */
+int is_stream_source(char * file_path)
+{
+    struct stat file_stat;
+
+    if (!strcmp(file_path, "-"))
+    {
+        return 1;
+    }
+
+    if (-1 == stat(file_path, &file_stat))
+    {
+        return 0;
+    }
+
+    if (S_ISFIFO(file_stat.st_mode) || S_ISCHR(file_stat.st_mode))
+    {
+        return 1;
+    }
+
+    return 0;
+}
+
 void print_usage(char * cmd_name)
 {
-    printf("Usage: %s \"counter\"|\"finder\" file_path split_num [word_to_find]\n", cmd_name);
+    printf("Usage: %s \"counter\"|\"finder\"|\"finder-n\" file_path|- split_num [word_to_find]\n", cmd_name);
+    printf("       %s \"charfreq\" file_path|- split_num [\"fold\"]\n", cmd_name);
+    printf("       %s \"regex\" file_path|- split_num pattern\n", cmd_name);
+    printf("       %s \"topk\" file_path|- split_num [k]\n", cmd_name);
 }
 
 
 int main(int argc, char * argv[])
 {
-    int i = 0, is_letter_counter = 0;
+    int i = 0;
     
     MAPREDUCE_SPEC spec;
     MAPREDUCE_RESULT result;
@@ -72,20 +99,89 @@ int main(int argc, char * argv[])
         exit(1);
     }
 
+    spec.map_flush_func = NULL; // only the "Top-K" task keeps map state across splits
+
     /* argv[1] must be either "counter", meaning the "Letter counter" task,
-       or "finder", meaning the "Word finder" task*/
+       "finder", meaning the "Word finder" task, "finder-n", the "Word finder" task
+       with the line number and byte offset of every matching line, "charfreq",
+       meaning the UTF-8 "Character frequency" task, "regex", meaning the "Regex finder" task,
+       or "topk", meaning the approximate "Top-K" most frequent words task */
     if (!strcmp(argv[1], "counter"))
     {
-        is_letter_counter = 1;
+        spec.map_func = letter_counter_map;
+        spec.reduce_func = letter_counter_reduce;
+        spec.usr_data = NULL;
     }
-    else if (!strcmp(argv[1], "finder"))
+    else if (!strcmp(argv[1], "finder") || !strcmp(argv[1], "finder-n"))
     {
-        is_letter_counter = 0;
         if (argc < 5) // there must be a argv[4], which is the word to find
         {
             print_usage(argv[0]);
             exit(1);
         }
+
+        if (!strcmp(argv[1], "finder"))
+        {
+            spec.map_func = word_finder_map;
+            spec.reduce_func = word_finder_reduce;
+        }
+        else
+        {
+            spec.map_func = word_finder_annotated_map;
+            spec.reduce_func = word_finder_annotated_reduce;
+        }
+        spec.usr_data = argv[4]; // argv[4] is the word to find
+    }
+    else if (!strcmp(argv[1], "charfreq"))
+    {
+        spec.map_func = char_freq_map;
+        spec.reduce_func = char_freq_reduce;
+        spec.usr_data = NULL;
+        if (argc >= 5) // optional argv[4] "fold" turns on case folding
+        {
+            if (strcmp(argv[4], "fold"))
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            spec.usr_data = argv[4];
+        }
+    }
+    else if (!strcmp(argv[1], "regex"))
+    {
+        char err[128];
+
+        if (argc < 5) // there must be a argv[4], which is the pattern
+        {
+            print_usage(argv[0]);
+            exit(1);
+        }
+
+        // compile once here; the map workers inherit the compiled regex through fork()
+        spec.usr_data = regex_compile(argv[4], REGEX_DEFAULT_DFA_MEM, err, sizeof(err));
+        if (NULL == spec.usr_data)
+        {
+            printf("Invalid pattern %s: %s\n", argv[4], err);
+            exit(1);
+        }
+        spec.map_func = regex_finder_map;
+        spec.reduce_func = regex_finder_reduce;
+    }
+    else if (!strcmp(argv[1], "topk"))
+    {
+        spec.map_func = topk_map;
+        spec.reduce_func = topk_reduce;
+        spec.map_flush_func = topk_flush;
+        spec.usr_data = "10";
+        if (argc >= 5) // optional argv[4] is the number of words to report
+        {
+            if (!str_is_decimal_num(argv[4]) || atoi(argv[4]) <= 0)
+            {
+                print_usage(argv[0]);
+                exit(1);
+            }
+            spec.usr_data = argv[4];
+        }
     }
     else
     {
@@ -93,10 +189,10 @@ int main(int argc, char * argv[])
         exit(1);
     }
 
-    // argv[2] is the input data file
-    if (!is_regular_file(argv[2]))
+    // argv[2] is the input data file, or "-"/a FIFO to stream the input
+    if (!is_regular_file(argv[2]) && !is_stream_source(argv[2]))
     {
-        printf("Regular file %s does not exist.\n", argv[2]);
+        printf("Regular file or stream %s does not exist.\n", argv[2]);
         exit(0);
     }
 
@@ -111,19 +207,6 @@ int main(int argc, char * argv[])
     spec.input_data_filepath = argv[2]; // argv[2] is the input data file
     spec.split_num = atoi(argv[3]); // argv[3] is the number of the splits
 
-    if (is_letter_counter)
-    {
-        spec.map_func = letter_counter_map;
-        spec.reduce_func = letter_counter_reduce;
-        spec.usr_data = NULL;
-    }
-    else
-    {
-        spec.map_func = word_finder_map;
-        spec.reduce_func = word_finder_reduce;
-        spec.usr_data = argv[4]; // argv[4] is the word to find
-    }
-
     result.filepath = "mr.rst"; // name of the output file (placed in the working directory)
     result.map_worker_pid = malloc(spec.split_num * sizeof(*result.map_worker_pid));
 	if (NULL == result.map_worker_pid)
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -7,9 +8,55 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <time.h>
+#include <semaphore.h>
+#include <sys/mman.h>
 #include "mapreduce.h"
 #include "common.h"
 
+#define STREAM_CHUNK_SIZE (1 << 20)  // bytes per streamed chunk handed to a map worker
+#define STREAM_MAX_SLOTS  16         // upper bound on chunks buffered in shared memory
+#define STREAM_POLL_MS    100        // how often a blocked reader checks that the map workers are alive
+
+/*
+Bounded queue shared between the streaming coordinator and the map workers.
+It lives in a MAP_SHARED anonymous mapping so the process-shared semaphores work across fork().
+empty_slots counts free chunk buffers (this is the backpressure on the reader),
+full_slots counts queued chunks plus one end-of-stream token per worker.
+A worker whose map function fails records itself in failed_worker and posts empty_slots,
+so a reader blocked on a full queue wakes up and stops instead of waiting forever.
+*/
+typedef struct _stream_queue
+{
+    sem_t empty_slots;
+    sem_t full_slots;
+    sem_t lock;                          // binary semaphore guarding the fields below
+    int slot_num;
+    int ready[STREAM_MAX_SLOTS];         // ring of slot indices waiting for a worker
+    int ready_head;
+    int ready_count;
+    int slot_busy[STREAM_MAX_SLOTS];     // 1 while the producer or a worker owns the slot
+    int slot_len[STREAM_MAX_SLOTS];      // number of valid bytes in each slot
+    long long slot_offset[STREAM_MAX_SLOTS]; // stream offset of the first byte in each slot
+    int failed_worker;                   // index + 1 of the first map worker that failed, 0 if none
+}STREAM_QUEUE;
+
+/*
+Where one chunk's map output landed: bytes [start, end) of worker's intermediate file.
+Streaming workers append one record per chunk to mr-<worker>.idx so the output can be put back in input order.
+The output of the map flush function gets offset LLONG_MAX, so it follows all chunk output.
+*/
+typedef struct _stream_section
+{
+    long long offset;   // stream offset of the chunk
+    int worker;
+    off_t start;
+    off_t end;
+}STREAM_SECTION;
+
 /*helper function to find the next newline character in a file
  this ensures that splits occur at line boundaries to maintain data integrity
  */
@@ -65,28 +112,432 @@ static void get_split_positions(int fd, off_t total_size, int split_num, off_t *
     #endif
 }
 
-// Main MapReduce function that coordinates the entire process
-void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
-{
-    struct timeval start, end;  //  measuring processing time
-    int input_fd;              // File descriptor for input file
-    off_t file_size;          // Size of input file
-    off_t *split_starts;      // Array to store starting positions of splits
-    off_t *split_sizes;       // Array to store sizes of splits
-    int *intermediate_fds;    // Array of file descriptors for intermediate files
+/*
+Returns 1 if the input should be consumed as a stream rather than split by offset:
+"-" means stdin, and anything that is not a regular file (FIFO, pipe, tty) cannot be lseek'ed
+*/
+static int is_stream_input(const char *path, int fd) {
+    struct stat st;
 
-    if (NULL == spec || NULL == result)
-    {
-        EXIT_ERROR(ERROR, "NULL pointer!\n");
+    if (strcmp(path, "-") == 0) {
+        return 1;
     }
-  
-    gettimeofday(&start, NULL);
+    if (fstat(fd, &st) < 0) {
+        return 0;
+    }
+    return !S_ISREG(st.st_mode);
+}
 
-    input_fd = open(spec->input_data_filepath, O_RDONLY);
-    if (input_fd < 0) {
-        EXIT_ERROR(ERROR, "Cannot open input file: %s\n", spec->input_data_filepath);
+// read() that retries on EINTR and keeps going until len bytes or EOF
+static ssize_t read_full(int fd, char *buf, size_t len) {
+    size_t total = 0;
+
+    while (total < len) {
+        ssize_t n = read(fd, buf + total, len - total);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (n == 0) break;
+        total += n;
     }
-    
+    return total;
+}
+
+/*
+Map worker loop for streaming mode: take chunks off the shared queue until the end-of-stream token,
+run the user map function on each one, append its output to the worker's intermediate file
+and record where it went in the worker's index file; the map flush function runs once at the end
+*/
+static int stream_map_worker(MAPREDUCE_SPEC *spec, STREAM_QUEUE *queue, int *slot_fds, int worker, int fd_out) {
+    char index_filename[32];
+    snprintf(index_filename, sizeof(index_filename), "mr-%d.idx", worker);
+    int index_fd = open(index_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    for (;;) {
+        int slot = -1;
+
+        while (sem_wait(&queue->full_slots) < 0 && errno == EINTR);
+        sem_wait(&queue->lock);
+        if (queue->ready_count > 0) {
+            slot = queue->ready[queue->ready_head];
+            queue->ready_head = (queue->ready_head + 1) % queue->slot_num;
+            queue->ready_count--;
+        }
+        sem_post(&queue->lock);
+
+        if (slot < 0) {  // end of stream
+            int ret = 0;
+            if (spec->map_flush_func) {
+                STREAM_SECTION section;
+                section.offset = LLONG_MAX;
+                section.worker = worker;
+                section.start = lseek(fd_out, 0, SEEK_CUR);
+
+                ret = -1;
+                if (index_fd >= 0 && section.start >= 0) {
+                    ret = spec->map_flush_func(spec->usr_data, fd_out);
+                }
+                if (ret == 0) {
+                    section.end = lseek(fd_out, 0, SEEK_CUR);
+                    if (section.end < 0 || write(index_fd, &section, sizeof(section)) != sizeof(section)) {
+                        ret = -1;
+                    }
+                }
+            }
+            close(index_fd);
+            return ret;
+        }
+
+        DATA_SPLIT split;
+        split.fd = slot_fds[slot];
+        split.size = queue->slot_len[slot];
+        split.offset = queue->slot_offset[slot];
+        split.usr_data = spec->usr_data;
+
+        STREAM_SECTION section;
+        section.offset = split.offset;
+        section.worker = worker;
+        section.start = lseek(fd_out, 0, SEEK_CUR);
+
+        int ret = -1;
+        if (index_fd >= 0 && section.start >= 0 && lseek(split.fd, 0, SEEK_SET) == 0) {
+            ret = spec->map_func(&split, fd_out);
+        }
+        if (ret == 0) {
+            section.end = lseek(fd_out, 0, SEEK_CUR);
+            if (section.end < 0 || write(index_fd, &section, sizeof(section)) != sizeof(section)) {
+                ret = -1;
+            }
+        }
+
+        sem_wait(&queue->lock);
+        queue->slot_busy[slot] = 0;
+        if (ret != 0 && !queue->failed_worker) {
+            queue->failed_worker = worker + 1;
+        }
+        sem_post(&queue->lock);
+        sem_post(&queue->empty_slots);
+
+        if (ret != 0) {
+            return -1;
+        }
+    }
+}
+
+// Kills the remaining map workers and exits; called when a streaming map worker failed or died
+static void stream_abort(MAPREDUCE_RESULT *result, int worker_num, int failed_worker) {
+    for (int i = 0; i < worker_num; i++) {
+        kill(result->map_worker_pid[i], SIGKILL);
+    }
+    for (int i = 0; i < worker_num; i++) {
+        waitpid(result->map_worker_pid[i], NULL, 0);
+    }
+    EXIT_ERROR(ERROR, "Map worker %d failed\n", failed_worker);
+}
+
+/*
+Waits for a free slot. Every STREAM_POLL_MS the reader checks whether a map worker reported a failure
+or exited (a worker that dies while owning a slot never posts it back); either one aborts the job.
+*/
+static void stream_wait_free_slot(STREAM_QUEUE *queue, MAPREDUCE_RESULT *result, int worker_num) {
+    for (;;) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += STREAM_POLL_MS * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int ret = sem_timedwait(&queue->empty_slots, &deadline);
+        if (queue->failed_worker) {
+            stream_abort(result, worker_num, queue->failed_worker - 1);
+        }
+        if (ret == 0) {
+            return;
+        }
+        if (errno != ETIMEDOUT && errno != EINTR) {
+            EXIT_ERROR(ERROR, "Waiting on the stream queue failed\n");
+        }
+
+        // no worker may exit before the end-of-stream tokens are posted
+        for (int i = 0; i < worker_num; i++) {
+            if (waitpid(result->map_worker_pid[i], NULL, WNOHANG) == result->map_worker_pid[i]) {
+                stream_abort(result, worker_num, i);
+            }
+        }
+    }
+}
+
+/*
+Streaming map phase: the coordinator reads the input in STREAM_CHUNK_SIZE pieces, cuts each piece
+after its last newline (the tail is carried into the next chunk) and queues it in a shared-memory slot.
+Each slot is backed by a memfd so the unmodified map functions can still read() it through split->fd.
+The reader blocks on empty_slots when all slots are queued or in use, so memory stays bounded
+no matter how large the stream is.
+Returns the number of intermediate files written (one per map worker).
+*/
+static int stream_map_phase(MAPREDUCE_SPEC *spec, MAPREDUCE_RESULT *result, int input_fd, int *intermediate_fds) {
+    int worker_num = spec->split_num;
+    int slot_num = 2 * worker_num < STREAM_MAX_SLOTS ? 2 * worker_num : STREAM_MAX_SLOTS;
+    int slot_fds[STREAM_MAX_SLOTS];
+    char *slot_bufs[STREAM_MAX_SLOTS];
+    char *carry;
+    size_t carry_len = 0;
+    long long stream_offset = 0;  // offset of the next chunk's first byte
+    int at_eof = 0;
+
+    STREAM_QUEUE *queue = mmap(NULL, sizeof(STREAM_QUEUE), PROT_READ | PROT_WRITE,
+                               MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    carry = malloc(STREAM_CHUNK_SIZE);
+    if (queue == MAP_FAILED || !carry) {
+        EXIT_ERROR(ERROR, "Cannot allocate stream queue\n");
+    }
+
+    memset(queue, 0, sizeof(*queue));
+    queue->slot_num = slot_num;
+    if (sem_init(&queue->empty_slots, 1, slot_num) < 0 ||
+        sem_init(&queue->full_slots, 1, 0) < 0 ||
+        sem_init(&queue->lock, 1, 1) < 0) {
+        EXIT_ERROR(ERROR, "Cannot initialise stream queue semaphores\n");
+    }
+
+    for (int i = 0; i < slot_num; i++) {
+        char slot_name[32];
+        snprintf(slot_name, sizeof(slot_name), "mr-stream-%d", i);
+        slot_fds[i] = memfd_create(slot_name, 0);
+        if (slot_fds[i] < 0 || ftruncate(slot_fds[i], STREAM_CHUNK_SIZE) < 0) {
+            EXIT_ERROR(ERROR, "Cannot create stream slot %d\n", i);
+        }
+        slot_bufs[i] = mmap(NULL, STREAM_CHUNK_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, slot_fds[i], 0);
+        if (slot_bufs[i] == MAP_FAILED) {
+            EXIT_ERROR(ERROR, "Cannot map stream slot %d\n", i);
+        }
+    }
+
+    // Create and launch map workers; they block on the queue until the first chunk arrives
+    for (int i = 0; i < worker_num; i++) {
+        char intermediate_filename[32];
+        snprintf(intermediate_filename, sizeof(intermediate_filename), "mr-%d.itm", i);
+
+        intermediate_fds[i] = open(intermediate_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (intermediate_fds[i] < 0) {
+            EXIT_ERROR(ERROR, "Cannot create intermediate file: %s\n", intermediate_filename);
+        }
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            EXIT_ERROR(ERROR, "Fork failed for map worker %d\n", i);
+        }
+        else if (pid == 0) {  // Child process (map worker)
+            close(input_fd);
+            for (int j = 0; j < i; j++) {
+                close(intermediate_fds[j]);
+            }
+
+            int ret = stream_map_worker(spec, queue, slot_fds, i, intermediate_fds[i]);
+
+            close(intermediate_fds[i]);
+            _exit(ret == 0 ? 0 : 1);
+        }
+        else {  // Parent process
+            result->map_worker_pid[i] = pid;
+        }
+    }
+
+    // Producer loop: fill free slots from the input until EOF
+    while (!at_eof) {
+        int slot = -1;
+
+        stream_wait_free_slot(queue, result, worker_num);
+        sem_wait(&queue->lock);
+        for (int i = 0; i < slot_num; i++) {
+            if (!queue->slot_busy[i]) {
+                slot = i;
+                queue->slot_busy[i] = 1;
+                break;
+            }
+        }
+        sem_post(&queue->lock);
+
+        char *buf = slot_bufs[slot];
+        memcpy(buf, carry, carry_len);
+        ssize_t bytes_read = read_full(input_fd, buf + carry_len, STREAM_CHUNK_SIZE - carry_len);
+        if (bytes_read < 0) {
+            EXIT_ERROR(ERROR, "Read from input stream failed\n");
+        }
+        size_t len = carry_len + bytes_read;
+        at_eof = (len < STREAM_CHUNK_SIZE);
+        carry_len = 0;
+
+        if (!at_eof) {
+            // Cut after the last newline; a chunk without any newline is one overlong line and is sent as is
+            size_t cut = len;
+            while (cut > 0 && buf[cut - 1] != '\n') cut--;
+            if (cut > 0) {
+                carry_len = len - cut;
+                memcpy(carry, buf + cut, carry_len);
+                len = cut;
+            }
+        }
+
+        sem_wait(&queue->lock);
+        if (len > 0) {
+            queue->slot_len[slot] = len;
+            queue->slot_offset[slot] = stream_offset;
+            stream_offset += len;
+            queue->ready[(queue->ready_head + queue->ready_count) % slot_num] = slot;
+            queue->ready_count++;
+        }
+        else {
+            queue->slot_busy[slot] = 0;
+        }
+        sem_post(&queue->lock);
+        sem_post(len > 0 ? &queue->full_slots : &queue->empty_slots);
+    }
+
+    // One end-of-stream token per worker
+    for (int i = 0; i < worker_num; i++) {
+        sem_post(&queue->full_slots);
+    }
+
+    for (int i = 0; i < worker_num; i++) {
+        int status;
+        waitpid(result->map_worker_pid[i], &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            EXIT_ERROR(ERROR, "Map worker %d failed\n", i);
+        }
+        close(intermediate_fds[i]);
+    }
+
+    for (int i = 0; i < slot_num; i++) {
+        munmap(slot_bufs[i], STREAM_CHUNK_SIZE);
+        close(slot_fds[i]);
+    }
+    sem_destroy(&queue->empty_slots);
+    sem_destroy(&queue->full_slots);
+    sem_destroy(&queue->lock);
+    munmap(queue, sizeof(STREAM_QUEUE));
+    free(carry);
+
+    return worker_num;
+}
+
+static int compare_stream_section(const void *a, const void *b) {
+    const STREAM_SECTION *x = a, *y = b;
+    if (x->offset != y->offset) {
+        return (x->offset > y->offset) - (x->offset < y->offset);
+    }
+    return x->worker - y->worker;
+}
+
+/*
+Reads the index files written by the streaming map workers and returns their sections in stream order.
+The caller frees *p_sections. Returns the number of sections.
+*/
+static int stream_load_sections(int worker_num, STREAM_SECTION **p_sections) {
+    STREAM_SECTION *sections = NULL;
+    int section_num = 0, section_cap = 0;
+    char filename[32];
+
+    for (int i = 0; i < worker_num; i++) {
+        STREAM_SECTION section;
+        ssize_t n;
+
+        snprintf(filename, sizeof(filename), "mr-%d.idx", i);
+        int index_fd = open(filename, O_RDONLY);
+        if (index_fd < 0) {
+            EXIT_ERROR(ERROR, "Cannot open index file: %s\n", filename);
+        }
+        while ((n = read(index_fd, &section, sizeof(section))) == sizeof(section)) {
+            if (section_num == section_cap) {
+                section_cap = section_cap ? section_cap * 2 : 64;
+                sections = realloc(sections, section_cap * sizeof(*sections));
+                if (!sections) {
+                    EXIT_ERROR(ERROR, "Memory allocation failed\n");
+                }
+            }
+            sections[section_num++] = section;
+        }
+        if (n != 0) {
+            EXIT_ERROR(ERROR, "Corrupt index file: %s\n", filename);
+        }
+        close(index_fd);
+        unlink(filename);
+    }
+
+    qsort(sections, section_num, sizeof(*sections), compare_stream_section);
+    *p_sections = sections;
+    return section_num;
+}
+
+/*
+Chunks are taken by whichever worker is free, so each intermediate file holds its chunks' output
+in arbitrary order. The reduce worker reads all sections in stream order from one pipe, fed by a
+child process that copies them straight out of the workers' intermediate files, so the reduce step
+sees exactly what it would for a regular file (e.g. finder output keeps the input's line order)
+without a reordered copy of the map output on disk.
+Returns the read end of the pipe and stores the feeder's pid in *feeder_pid, or returns -1 on error.
+*/
+static int stream_open_ordered(int worker_num, const STREAM_SECTION *sections, int section_num, pid_t *feeder_pid) {
+    int fds[2];
+
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    else if (pid == 0) {  // Child process (feeder)
+        int *itm_fds = malloc(worker_num * sizeof(int));
+        char buffer[65536];
+        char filename[32];
+
+        close(fds[0]);
+        if (!itm_fds) {
+            _EXIT_ERROR(ERROR, "Memory allocation failed\n");
+        }
+        for (int i = 0; i < worker_num; i++) {
+            snprintf(filename, sizeof(filename), "mr-%d.itm", i);
+            itm_fds[i] = open(filename, O_RDONLY);
+            if (itm_fds[i] < 0) {
+                _EXIT_ERROR(ERROR, "Cannot open intermediate file: %s\n", filename);
+            }
+        }
+        for (int i = 0; i < section_num; i++) {
+            off_t pos = sections[i].start;
+            while (pos < sections[i].end) {
+                size_t want = sections[i].end - pos < (off_t)sizeof(buffer) ? sections[i].end - pos : sizeof(buffer);
+                ssize_t n = pread(itm_fds[sections[i].worker], buffer, want, pos);
+                if (n <= 0 || write(fds[1], buffer, n) != n) {
+                    _EXIT_ERROR(ERROR, "Copying intermediate data failed\n");
+                }
+                pos += n;
+            }
+        }
+        close(fds[1]);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    *feeder_pid = pid;
+    return fds[0];
+}
+
+/*
+Offset-based map phase for regular files: split the file at line boundaries and give each
+map worker its own descriptor positioned at the start of its split.
+Returns the number of intermediate files written (one per split).
+*/
+static int split_map_phase(MAPREDUCE_SPEC *spec, MAPREDUCE_RESULT *result, int input_fd, int *intermediate_fds) {
+    off_t file_size;          // Size of input file
+    off_t *split_starts;      // Array to store starting positions of splits
+    off_t *split_sizes;       // Array to store sizes of splits
+
     file_size = lseek(input_fd, 0, SEEK_END);
     if (file_size <= 0) {
         close(input_fd);
@@ -96,14 +547,12 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
     int actual_split_num = (file_size < spec->split_num) ? 1 : spec->split_num;
     split_starts = malloc(actual_split_num * sizeof(off_t));
     split_sizes = malloc(actual_split_num * sizeof(off_t));
-    intermediate_fds = malloc(actual_split_num * sizeof(int));
     
     // Check if memory allocation was successful
-    if (!split_starts || !split_sizes || !intermediate_fds) {
+    if (!split_starts || !split_sizes) {
         close(input_fd);
         free(split_starts);
         free(split_sizes);
-        free(intermediate_fds);
         EXIT_ERROR(ERROR, "Memory allocation failed\n");
     }
     
@@ -144,6 +593,7 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
             DATA_SPLIT split;
             split.fd = worker_fd;
             split.size = split_sizes[i];
+            split.offset = split_starts[i];
             split.usr_data = spec->usr_data;
 
             if (lseek(worker_fd, split_starts[i], SEEK_SET) < 0) {
@@ -151,6 +601,9 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
             }
             
             int ret = spec->map_func(&split, intermediate_fds[i]);
+            if (ret == 0 && spec->map_flush_func) {
+                ret = spec->map_flush_func(spec->usr_data, intermediate_fds[i]);
+            }
             
             // Cleanup and exit
             close(worker_fd);
@@ -172,6 +625,57 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
         }
         close(intermediate_fds[i]);
     }
+
+    free(split_starts);
+    free(split_sizes);
+
+    return actual_split_num;
+}
+
+// Main MapReduce function that coordinates the entire process
+void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
+{
+    struct timeval start, end;  //  measuring processing time
+    int input_fd;              // File descriptor for input file
+    int *intermediate_fds;    // Array of file descriptors for intermediate files
+    int intermediate_num;     // Number of intermediate files produced by the map phase
+    STREAM_SECTION *sections = NULL; // Streaming mode: where each chunk's map output is, in stream order
+    int section_num = -1;     // Number of sections, -1 for a regular file
+
+    if (NULL == spec || NULL == result)
+    {
+        EXIT_ERROR(ERROR, "NULL pointer!\n");
+    }
+    if (spec->split_num <= 0)
+    {
+        EXIT_ERROR(ERROR, "Invalid split number: %d\n", spec->split_num);
+    }
+  
+    gettimeofday(&start, NULL);
+
+    if (strcmp(spec->input_data_filepath, "-") == 0) {
+        input_fd = STDIN_FILENO;
+    }
+    else {
+        input_fd = open(spec->input_data_filepath, O_RDONLY);
+    }
+    if (input_fd < 0) {
+        EXIT_ERROR(ERROR, "Cannot open input file: %s\n", spec->input_data_filepath);
+    }
+
+    intermediate_fds = malloc(spec->split_num * sizeof(int));
+    if (!intermediate_fds) {
+        close(input_fd);
+        EXIT_ERROR(ERROR, "Memory allocation failed\n");
+    }
+
+    if (is_stream_input(spec->input_data_filepath, input_fd)) {
+        intermediate_num = stream_map_phase(spec, result, input_fd, intermediate_fds);
+        section_num = stream_load_sections(intermediate_num, &sections);
+    }
+    else {
+        intermediate_num = split_map_phase(spec, result, input_fd, intermediate_fds);
+    }
     
     // Create and launch reduce worker
     pid_t reduce_pid = fork();
@@ -185,8 +689,18 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
             _EXIT_ERROR(ERROR, "Cannot create result file\n");
         }
         
+        // In streaming mode the reduce function reads the map output in stream order from a pipe
+        pid_t feeder_pid = -1;
+        if (section_num >= 0) {
+            intermediate_fds[0] = stream_open_ordered(intermediate_num, sections, section_num, &feeder_pid);
+            if (intermediate_fds[0] < 0) {
+                _EXIT_ERROR(ERROR, "Cannot start feeding intermediate data\n");
+            }
+            intermediate_num = 1;
+        }
+
         // Open all intermediate files for reading
-        for (int i = 0; i < actual_split_num; i++) {
+        for (int i = 0; i < intermediate_num && feeder_pid < 0; i++) {
             char intermediate_filename[32];
             snprintf(intermediate_filename, sizeof(intermediate_filename), "mr-%d.itm", i);
             intermediate_fds[i] = open(intermediate_filename, O_RDONLY);
@@ -195,13 +709,20 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
             }
         }
 
-        int ret = spec->reduce_func(intermediate_fds, actual_split_num, result_fd);
+        int ret = spec->reduce_func(intermediate_fds, intermediate_num, result_fd);
         
         // Cleanup and exit
         close(result_fd);
-        for (int i = 0; i < actual_split_num; i++) {
+        for (int i = 0; i < intermediate_num; i++) {
             close(intermediate_fds[i]);
         }
+        if (feeder_pid > 0) {
+            int status;
+            waitpid(feeder_pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                ret = -1;
+            }
+        }
         
         _exit(ret == 0 ? 0 : 1);  
     }
@@ -217,10 +738,11 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result)
     }
     
     // Final cleanup
-    close(input_fd);
-    free(split_starts);
-    free(split_sizes);
+    if (input_fd != STDIN_FILENO) {
+        close(input_fd);
+    }
     free(intermediate_fds);
+    free(sections);
 
     gettimeofday(&end, NULL);   
     result->processing_time = (end.tv_sec - start.tv_sec) * US_PER_SEC + (end.tv_usec - start.tv_usec);
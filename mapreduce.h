@@ -3,20 +3,26 @@
 #ifndef _MAPREDUCE_H
 #define _MAPREDUCE_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* The data split type */
 typedef struct _data_split
 {
     int fd;  /* The file descriptor of the input data file */
     int size; /* The size of the split */
+    long long offset; /* The byte offset of the split within the input data (stream offset in streaming mode) */
     void * usr_data;  /* This field is used only by the "Word finder" program: it records the word to find in the input data file */
 }DATA_SPLIT;
 
 typedef struct _mapreduce_spec
 {
-    char * input_data_filepath; /* The path of the (large) input data file */
-    int split_num; /* The number of splits */
+    char * input_data_filepath; /* The path of the (large) input data file; "-" or a FIFO is read as a stream */
+    int split_num; /* The number of splits (the number of map workers in streaming mode) */
     int (*map_func)(DATA_SPLIT * split, int fd_out); /* Function pointer to the user-defined map function */
     int (*reduce_func)(int * p_fd_in, int fd_in_num, int fd_out); /* Function pointer to the user-defined reduce function */
+    int (*map_flush_func)(void * usr_data, int fd_out); /* Optional (NULL if unused): called once by each map worker after its last split, for map functions that keep state across splits */
     void * usr_data; /* This field is used only by the "Word finder" program: it records the word to find in the input data file */
 }MAPREDUCE_SPEC;
 
@@ -33,4 +39,8 @@ void mapreduce(MAPREDUCE_SPEC * spec, MAPREDUCE_RESULT * result);
 
 
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,417 @@
+/* Header-only C++ layer over the mapreduce framework.
+
+   MapReduce<Mapper, Reducer, Key, Value> runs a job whose map and reduce steps are functors, so they are
+   inlined into the scan and merge loops instead of being called through function pointers:
+
+       struct Mapper {
+           // optional: keys are the integers [0, key_count) and the per-worker table is a std::array
+           static constexpr std::size_t key_count = 26;
+           template <class Emit> void operator()(const char * begin, const char * end, Emit && emit) const;
+       };
+       struct Reducer {
+           Value operator()(const Value & a, const Value & b) const;  // associative and commutative
+       };
+
+   Each map worker scans its split of the memory-mapped input, combines the emitted pairs locally with
+   the Reducer, and sends its table to the coordinator serialised by Codec<Key> / Codec<Value>, which
+   are chosen at compile time. Existing C jobs run unchanged through run_c_job(). */
+
+#ifndef _MAPREDUCE_HPP
+#define _MAPREDUCE_HPP
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "mapreduce.h"
+
+namespace mr
+{
+
+/* Reports a fatal error of the typed runner the way the C framework does, on stdout, and exits.
+   (common.h is not included here so its macros, e.g. ERROR, do not leak into every includer.) */
+[[noreturn]] inline void fail(const char * fmt, ...) __attribute__((format(printf, 1, 2)));
+
+inline void fail(const char * fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    printf("ERROR in mr::MapReduce::run(): ");
+    vprintf(fmt, args);
+    va_end(args);
+    exit(-1);
+}
+
+/* ----- Codecs: compile-time selected serialisation of keys and values ----- */
+
+/* Trivially copyable types are copied as raw bytes. Specialise Codec for other types. */
+template <class T, class Enable = void>
+struct Codec
+{
+    static_assert(std::is_trivially_copyable<T>::value, "no mr::Codec specialisation for this type");
+
+    static void write(std::string & out, const T & v)
+    {
+        out.append(reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+
+    static bool read(const char *& p, const char * end, T & v)
+    {
+        if (end - p < (std::ptrdiff_t)sizeof(T)) return false;
+        memcpy(&v, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+};
+
+/* Strings are written as a 32-bit length followed by the bytes */
+template <>
+struct Codec<std::string>
+{
+    static void write(std::string & out, const std::string & v)
+    {
+        Codec<uint32_t>::write(out, (uint32_t)v.size());
+        out.append(v);
+    }
+
+    static bool read(const char *& p, const char * end, std::string & v)
+    {
+        uint32_t len;
+        if (!Codec<uint32_t>::read(p, end, len) || end - p < (std::ptrdiff_t)len) return false;
+        v.assign(p, len);
+        p += len;
+        return true;
+    }
+};
+
+/* ----- Per-worker tables ----- */
+
+template <class Mapper, class = void>
+struct has_key_count : std::false_type {};
+
+template <class Mapper>
+struct has_key_count<Mapper, decltype((void)Mapper::key_count)> : std::true_type {};
+
+/* General case: keys are combined in a hash table and serialised as a count followed by the pairs */
+template <class Mapper, class Reducer, class Key, class Value, class Enable = void>
+class Table
+{
+public:
+    void add(const Key & key, const Value & value, const Reducer & reduce)
+    {
+        auto it = map_.find(key);
+        if (it == map_.end()) {
+            map_.emplace(key, value);
+        }
+        else {
+            it->second = reduce(it->second, value);
+        }
+    }
+
+    void serialize(std::string & out) const
+    {
+        Codec<uint64_t>::write(out, (uint64_t)map_.size());
+        for (const auto & kv : map_) {
+            Codec<Key>::write(out, kv.first);
+            Codec<Value>::write(out, kv.second);
+        }
+    }
+
+    bool merge(const char * p, const char * end, const Reducer & reduce)
+    {
+        uint64_t n;
+        if (!Codec<uint64_t>::read(p, end, n)) return false;
+        for (uint64_t i = 0; i < n; i++) {
+            Key key;
+            Value value;
+            if (!Codec<Key>::read(p, end, key) || !Codec<Value>::read(p, end, value)) return false;
+            add(key, value, reduce);
+        }
+        return p == end;
+    }
+
+    std::vector<std::pair<Key, Value>> pairs() const
+    {
+        std::vector<std::pair<Key, Value>> out(map_.begin(), map_.end());
+        std::sort(out.begin(), out.end(),
+                  [](const std::pair<Key, Value> & a, const std::pair<Key, Value> & b) { return a.first < b.first; });
+        return out;
+    }
+
+private:
+    std::unordered_map<Key, Value> map_;
+};
+
+/* Fixed key space: the table is a constant-size array indexed by the key and is serialised as
+   key_count values, with no keys on the wire */
+template <class Mapper, class Reducer, class Key, class Value>
+class Table<Mapper, Reducer, Key, Value, typename std::enable_if<has_key_count<Mapper>::value>::type>
+{
+    static_assert(std::is_integral<Key>::value, "fixed-key jobs need an integral Key");
+    static constexpr std::size_t N = Mapper::key_count;
+
+public:
+    Table() { values_.fill(Value()); }
+
+    void add(const Key & key, const Value & value, const Reducer & reduce)
+    {
+        assert((std::size_t)key < N);
+        values_[key] = reduce(values_[key], value);
+    }
+
+    void serialize(std::string & out) const
+    {
+        for (const Value & v : values_) {
+            Codec<Value>::write(out, v);
+        }
+    }
+
+    bool merge(const char * p, const char * end, const Reducer & reduce)
+    {
+        for (std::size_t k = 0; k < N; k++) {
+            Value value;
+            if (!Codec<Value>::read(p, end, value)) return false;
+            values_[k] = reduce(values_[k], value);
+        }
+        return p == end;
+    }
+
+    std::vector<std::pair<Key, Value>> pairs() const
+    {
+        std::vector<std::pair<Key, Value>> out;
+        out.reserve(N);
+        for (std::size_t k = 0; k < N; k++) {
+            out.emplace_back((Key)k, values_[k]);
+        }
+        return out;
+    }
+
+private:
+    std::array<Value, N> values_;
+};
+
+/* ----- Typed job runner ----- */
+
+template <class Key, class Value>
+struct Result
+{
+    std::vector<std::pair<Key, Value>> pairs;  /* reduced pairs, ordered by key */
+    int processing_time;                       /* in microseconds */
+    std::vector<int> map_worker_pid;
+};
+
+template <class Mapper, class Reducer, class Key, class Value>
+class MapReduce
+{
+public:
+    typedef Table<Mapper, Reducer, Key, Value> TableType;
+
+    explicit MapReduce(Mapper mapper = Mapper(), Reducer reducer = Reducer())
+        : mapper_(mapper), reducer_(reducer) {}
+
+    /* Runs the job over the regular file at input_path with split_num map workers.
+       Splits end at line boundaries, like the C framework. */
+    Result<Key, Value> run(const char * input_path, int split_num) const
+    {
+        struct timeval start, end;
+        Result<Key, Value> result;
+
+        gettimeofday(&start, NULL);
+
+        int fd = open(input_path, O_RDONLY);
+        if (fd < 0) {
+            fail("Cannot open input file: %s\n", input_path);
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+            close(fd);
+            fail("Empty or invalid input file\n");
+        }
+        size_t size = st.st_size;
+        const char * data = (const char *)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            fail("Cannot map input file: %s\n", input_path);
+        }
+
+        if (split_num <= 0) {
+            fail("Invalid split number: %d\n", split_num);
+        }
+        if (size < (size_t)split_num) {
+            split_num = 1;
+        }
+        std::vector<size_t> bounds = split_bounds(data, size, split_num);
+
+        // Launch map workers, each writes its serialised table to a pipe
+        std::vector<int> pipes(split_num);
+        for (int i = 0; i < split_num; i++) {
+            int fds[2];
+            if (pipe(fds) < 0) {
+                fail("Cannot create pipe for map worker %d\n", i);
+            }
+
+            pid_t pid = fork();
+            if (pid < 0) {
+                fail("Fork failed for map worker %d\n", i);
+            }
+            else if (pid == 0) {  // Child process (map worker)
+                close(fds[0]);
+                for (int j = 0; j < i; j++) {
+                    close(pipes[j]);
+                }
+                int ret = map_worker(data + bounds[i], data + bounds[i + 1], fds[1]);
+                close(fds[1]);
+                _exit(ret == 0 ? 0 : 1);
+            }
+            close(fds[1]);
+            pipes[i] = fds[0];
+            result.map_worker_pid.push_back(pid);
+        }
+
+        // Reduce: merge the tables in the coordinator as they arrive
+        TableType table;
+        std::string buf;
+        for (int i = 0; i < split_num; i++) {
+            if (read_all(pipes[i], buf) < 0 || !table.merge(buf.data(), buf.data() + buf.size(), reducer_)) {
+                fail("Bad intermediate data from map worker %d\n", i);
+            }
+            close(pipes[i]);
+
+            int status;
+            waitpid(result.map_worker_pid[i], &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                fail("Map worker %d failed\n", i);
+            }
+        }
+        munmap((void *)data, size);
+
+        result.pairs = table.pairs();
+        gettimeofday(&end, NULL);
+        result.processing_time = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_usec - start.tv_usec);
+        return result;
+    }
+
+private:
+    /* Split offsets: split i is [bounds[i], bounds[i + 1]), each split ends after a newline */
+    static std::vector<size_t> split_bounds(const char * data, size_t size, int split_num)
+    {
+        std::vector<size_t> bounds(split_num + 1);
+        bounds[0] = 0;
+        for (int i = 1; i < split_num; i++) {
+            size_t target = std::max(bounds[i - 1], (size_t)i * (size / split_num));
+            const char * nl = (const char *)memchr(data + target, '\n', size - target);
+            bounds[i] = nl ? (size_t)(nl - data) + 1 : size;
+        }
+        bounds[split_num] = size;
+        return bounds;
+    }
+
+    int map_worker(const char * begin, const char * end, int fd_out) const
+    {
+        TableType table;
+        const Reducer & reduce = reducer_;
+
+        mapper_(begin, end, [&table, &reduce](const Key & key, const Value & value) {
+            table.add(key, value, reduce);
+        });
+
+        std::string out;
+        table.serialize(out);
+        return write_all(fd_out, out.data(), out.size());
+    }
+
+    static int write_all(int fd, const char * p, size_t len)
+    {
+        while (len > 0) {
+            ssize_t n = write(fd, p, len);
+            if (n < 0) return -1;
+            p += n;
+            len -= n;
+        }
+        return 0;
+    }
+
+    static int read_all(int fd, std::string & out)
+    {
+        char chunk[65536];
+        ssize_t n;
+
+        out.clear();
+        while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+            out.append(chunk, n);
+        }
+        return n < 0 ? -1 : 0;
+    }
+
+    Mapper mapper_;
+    Reducer reducer_;
+};
+
+/* ----- Adapter for the C API ----- */
+
+struct CJobResult
+{
+    std::string filepath;
+    int processing_time;
+    std::vector<int> map_worker_pid;
+    int reduce_worker_pid;
+};
+
+/* Runs a C job (map_func/reduce_func over file descriptors) through mapreduce().
+   Jobs that keep map state across splits, such as topk_map, must pass their map_flush_func. */
+inline CJobResult run_c_job(int (*map_func)(DATA_SPLIT * split, int fd_out),
+                            int (*reduce_func)(int * p_fd_in, int fd_in_num, int fd_out),
+                            void * usr_data, const char * input_path, int split_num,
+                            const char * result_path = "mr.rst",
+                            int (*map_flush_func)(void * usr_data, int fd_out) = NULL)
+{
+    MAPREDUCE_SPEC spec;
+    MAPREDUCE_RESULT result;
+    CJobResult out;
+
+    spec.input_data_filepath = const_cast<char *>(input_path);
+    spec.split_num = split_num;
+    spec.map_func = map_func;
+    spec.reduce_func = reduce_func;
+    spec.map_flush_func = map_flush_func;
+    spec.usr_data = usr_data;
+
+    out.map_worker_pid.resize(split_num);
+    result.filepath = const_cast<char *>(result_path);
+    result.map_worker_pid = out.map_worker_pid.data();
+
+    mapreduce(&spec, &result);
+
+    out.filepath = result_path;
+    out.processing_time = result.processing_time;
+    out.reduce_worker_pid = result.reduce_worker_pid;
+    return out;
+}
+
+/* Reducer for counting jobs */
+template <class Value>
+struct Sum
+{
+    Value operator()(const Value & a, const Value & b) const { return a + b; }
+};
+
+} // namespace mr
+
+#endif
@@ -0,0 +1,843 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "regex_dfa.h"
+
+/*
+The pattern is compiled into a Thompson NFA once (in the coordinator, before the map workers are forked).
+DFA states are sets of NFA states and are built on demand while scanning, so only the transitions a split
+actually uses are ever constructed. Every DFA state keeps a 256-entry transition row, and when the cached
+states exceed the memory cap the whole cache is dropped and rebuilding starts from the current position,
+so memory stays bounded for patterns whose full DFA would explode. If the cache keeps getting flushed
+before it pays off, the worker gives up on the DFA and simulates the NFA directly instead.
+*/
+
+enum
+{
+    NFA_SET,    /* consume one byte in set */
+    NFA_EPS,    /* epsilon edge to out */
+    NFA_SPLIT,  /* epsilon edges to out and out1 */
+    NFA_BOL,    /* '^': epsilon edge taken only at the start of the line */
+    NFA_EOL,    /* '$': epsilon edge taken only at the end of the line */
+    NFA_MATCH
+};
+
+typedef struct _nfa_state
+{
+    int type;
+    int out;
+    int out1;
+    int set;    /* index into REGEX.sets for NFA_SET */
+}NFA_STATE;
+
+/* A partially built NFA: entry state and the NFA_EPS state every path leaves through */
+typedef struct _nfa_frag
+{
+    int start;
+    int end;
+}NFA_FRAG;
+
+#define DFA_MATCH     0x1  /* contains NFA_MATCH: the line matches as soon as this state is reached */
+#define DFA_EOL_MATCH 0x2  /* reaches NFA_MATCH through '$' at the end of the line */
+#define DFA_BOL       0x4  /* built at the start of the line ('^' edges were followed) */
+
+#define DFA_UNKNOWN   -1   /* transition not built yet */
+
+#define DFA_MIN_BYTES_PER_STATE 10  /* below this a flushed cache was not worth building */
+
+typedef struct _dfa_state
+{
+    int next[256];
+    int flags;
+    int nfa_num;
+    int nfa[];   /* sorted NFA state indices */
+}DFA_STATE;
+
+struct _regex
+{
+    NFA_STATE * nfa;
+    int nfa_num, nfa_cap;
+    unsigned char (* sets)[32];
+    int set_num, set_cap;
+    int start;
+
+    /* literal prefix every match starts with, used to skip lines and to jump to the first candidate */
+    char * prefix;
+    size_t prefix_len;
+    int anchored;  /* the pattern begins with '^' */
+
+    /* lazily built DFA */
+    DFA_STATE ** states;
+    int state_num, state_cap;
+    int * hash;        /* open addressing table of state indices, -1 when empty */
+    int hash_cap;      /* power of two, at least twice state_cap */
+    char * arena;      /* DFA states are carved out of one block of mem_cap bytes */
+    size_t mem_used, mem_cap;
+    int start_state[2];  /* [0] mid-line start, [1] start of line; DFA_UNKNOWN until built */
+    int flush_count;
+    size_t bytes_since_flush;
+    int nfa_only;      /* set once the DFA cache thrashes; matching falls back to NFA simulation */
+
+    /* scratch space for closures */
+    int * stack;
+    int * mark;
+    int mark_gen;
+    int * work;
+    int * closure;
+    int * closure2;
+};
+
+/* ----- Parser: recursive descent producing an NFA ----- */
+
+typedef struct _parser
+{
+    REGEX * re;
+    const char * pattern;
+    const char * p;
+    char * err;
+    size_t err_len;
+    int failed;
+}PARSER;
+
+static void parse_error(PARSER * ps, const char * msg)
+{
+    if (!ps->failed) {
+        snprintf(ps->err, ps->err_len, "%s at offset %d", msg, (int)(ps->p - ps->pattern));
+        ps->failed = 1;
+    }
+}
+
+static int nfa_add(PARSER * ps, int type, int out, int out1)
+{
+    REGEX * re = ps->re;
+
+    if (re->nfa_num == re->nfa_cap) {
+        int cap = re->nfa_cap ? re->nfa_cap * 2 : 64;
+        NFA_STATE * grown = realloc(re->nfa, cap * sizeof(*grown));
+        if (!grown) {
+            parse_error(ps, "out of memory");
+            return 0;
+        }
+        re->nfa = grown;
+        re->nfa_cap = cap;
+    }
+    NFA_STATE * s = &re->nfa[re->nfa_num];
+    s->type = type;
+    s->out = out;
+    s->out1 = out1;
+    s->set = -1;
+    return re->nfa_num++;
+}
+
+static int set_add(PARSER * ps, const unsigned char * bits)
+{
+    REGEX * re = ps->re;
+
+    if (re->set_num == re->set_cap) {
+        int cap = re->set_cap ? re->set_cap * 2 : 16;
+        unsigned char (* grown)[32] = realloc(re->sets, cap * sizeof(*grown));
+        if (!grown) {
+            parse_error(ps, "out of memory");
+            return 0;
+        }
+        re->sets = grown;
+        re->set_cap = cap;
+    }
+    memcpy(re->sets[re->set_num], bits, 32);
+    return re->set_num++;
+}
+
+static void bit_set(unsigned char * bits, int c)
+{
+    bits[c >> 3] |= 1 << (c & 7);
+}
+
+static void bit_range(unsigned char * bits, int lo, int hi)
+{
+    for (int c = lo; c <= hi; c++) {
+        bit_set(bits, c);
+    }
+}
+
+static void bits_invert(unsigned char * bits)
+{
+    for (int i = 0; i < 32; i++) {
+        bits[i] = ~bits[i];
+    }
+}
+
+/* Adds the class for \d \w \s (and their negations) to bits. @ret: 0 if c is not a class escape. */
+static int class_escape(unsigned char * bits, char c)
+{
+    unsigned char tmp[32] = {0};
+
+    switch (c) {
+    case 'd': case 'D':
+        bit_range(tmp, '0', '9');
+        break;
+    case 'w': case 'W':
+        bit_range(tmp, '0', '9');
+        bit_range(tmp, 'a', 'z');
+        bit_range(tmp, 'A', 'Z');
+        bit_set(tmp, '_');
+        break;
+    case 's': case 'S':
+        bit_set(tmp, ' ');
+        bit_range(tmp, '\t', '\r');
+        break;
+    default:
+        return 0;
+    }
+    if (c == 'D' || c == 'W' || c == 'S') {
+        bits_invert(tmp);
+    }
+    for (int i = 0; i < 32; i++) {
+        bits[i] |= tmp[i];
+    }
+    return 1;
+}
+
+/* Byte denoted by the escape "\c" when it is not a class escape.
+   Only \t, \n, \r and escaped ASCII punctuation are literals; anything else (\b, \1, \x41, ...)
+   means something in other regex dialects, so it is rejected instead of silently matching a letter.
+   @ret: the byte, or -1 for an unsupported escape. */
+static int escaped_byte(char c)
+{
+    switch (c) {
+    case 't': return '\t';
+    case 'n': return '\n';
+    case 'r': return '\r';
+    }
+    if (c > 0 && ispunct((unsigned char)c)) {
+        return (unsigned char)c;
+    }
+    return -1;
+}
+
+static int parse_escaped_byte(PARSER * ps, char c)
+{
+    int b = escaped_byte(c);
+    if (b < 0) {
+        parse_error(ps, "unsupported escape");
+    }
+    return b;
+}
+
+static NFA_FRAG frag_set(PARSER * ps, const unsigned char * bits)
+{
+    NFA_FRAG f;
+    f.end = nfa_add(ps, NFA_EPS, -1, -1);
+    f.start = nfa_add(ps, NFA_SET, f.end, -1);
+    if (!ps->failed) {
+        ps->re->nfa[f.start].set = set_add(ps, bits);
+    }
+    return f;
+}
+
+static NFA_FRAG frag_empty(PARSER * ps)
+{
+    NFA_FRAG f;
+    f.start = f.end = nfa_add(ps, NFA_EPS, -1, -1);
+    return f;
+}
+
+static NFA_FRAG parse_alt(PARSER * ps);
+
+static NFA_FRAG parse_class(PARSER * ps)
+{
+    unsigned char bits[32] = {0};
+    int negate = 0, first = 1;
+
+    ps->p++;  // '['
+    if (*ps->p == '^') {
+        negate = 1;
+        ps->p++;
+    }
+    while (*ps->p && (*ps->p != ']' || first)) {
+        int lo;
+        first = 0;
+        if (*ps->p == '\\' && ps->p[1]) {
+            if (class_escape(bits, ps->p[1])) {
+                ps->p += 2;
+                continue;
+            }
+            lo = parse_escaped_byte(ps, ps->p[1]);
+            if (lo < 0) {
+                return frag_empty(ps);
+            }
+            ps->p += 2;
+        }
+        else {
+            lo = (unsigned char)*ps->p++;
+        }
+
+        if (*ps->p == '-' && ps->p[1] && ps->p[1] != ']') {
+            int hi;
+            ps->p++;
+            if (*ps->p == '\\' && ps->p[1]) {
+                hi = parse_escaped_byte(ps, ps->p[1]);
+                if (hi < 0) {
+                    return frag_empty(ps);
+                }
+                ps->p += 2;
+            }
+            else {
+                hi = (unsigned char)*ps->p++;
+            }
+            if (hi < lo) {
+                parse_error(ps, "invalid class range");
+                return frag_empty(ps);
+            }
+            bit_range(bits, lo, hi);
+        }
+        else {
+            bit_set(bits, lo);
+        }
+    }
+    if (*ps->p != ']') {
+        parse_error(ps, "missing ']'");
+        return frag_empty(ps);
+    }
+    ps->p++;
+
+    if (negate) {
+        bits_invert(bits);
+    }
+    return frag_set(ps, bits);
+}
+
+static NFA_FRAG parse_atom(PARSER * ps)
+{
+    unsigned char bits[32] = {0};
+    NFA_FRAG f;
+    char c = *ps->p;
+
+    switch (c) {
+    case '(':
+        ps->p++;
+        f = parse_alt(ps);
+        if (*ps->p != ')') {
+            parse_error(ps, "missing ')'");
+            return f;
+        }
+        ps->p++;
+        return f;
+    case '[':
+        return parse_class(ps);
+    case '.':
+        ps->p++;
+        bit_range(bits, 0, 255);
+        bits[1] &= ~(1 << 2);  // everything but '\n'
+        return frag_set(ps, bits);
+    case '^':
+    case '$':
+        ps->p++;
+        f.end = nfa_add(ps, NFA_EPS, -1, -1);
+        f.start = nfa_add(ps, c == '^' ? NFA_BOL : NFA_EOL, f.end, -1);
+        return f;
+    case '\\':
+        if (!ps->p[1]) {
+            parse_error(ps, "trailing '\\'");
+            return frag_empty(ps);
+        }
+        if (!class_escape(bits, ps->p[1])) {
+            int b = parse_escaped_byte(ps, ps->p[1]);
+            if (b < 0) {
+                return frag_empty(ps);
+            }
+            bit_set(bits, b);
+        }
+        ps->p += 2;
+        return frag_set(ps, bits);
+    case '*':
+    case '+':
+    case '?':
+        parse_error(ps, "nothing to repeat");
+        return frag_empty(ps);
+    case '{':
+        parse_error(ps, "'{n,m}' repetition is not supported");
+        return frag_empty(ps);
+    default:
+        ps->p++;
+        bit_set(bits, (unsigned char)c);
+        return frag_set(ps, bits);
+    }
+}
+
+static NFA_FRAG parse_repeat(PARSER * ps)
+{
+    NFA_FRAG f = parse_atom(ps);
+
+    while (!ps->failed && (*ps->p == '*' || *ps->p == '+' || *ps->p == '?')) {
+        int end = nfa_add(ps, NFA_EPS, -1, -1);
+        int split = nfa_add(ps, NFA_SPLIT, f.start, end);
+        if (ps->failed) {
+            break;
+        }
+
+        switch (*ps->p++) {
+        case '*':   // split -> (f -> split) | end
+            ps->re->nfa[f.end].out = split;
+            f.start = split;
+            break;
+        case '+':   // f -> split -> f | end
+            ps->re->nfa[f.end].out = split;
+            break;
+        case '?':   // split -> (f -> end) | end
+            ps->re->nfa[f.end].out = end;
+            f.start = split;
+            break;
+        }
+        f.end = end;
+    }
+    return f;
+}
+
+static NFA_FRAG parse_concat(PARSER * ps)
+{
+    NFA_FRAG f = frag_empty(ps);
+
+    while (!ps->failed && *ps->p && *ps->p != '|' && *ps->p != ')') {
+        NFA_FRAG next = parse_repeat(ps);
+        if (ps->failed) {
+            break;
+        }
+        ps->re->nfa[f.end].out = next.start;
+        f.end = next.end;
+    }
+    return f;
+}
+
+static NFA_FRAG parse_alt(PARSER * ps)
+{
+    NFA_FRAG f = parse_concat(ps);
+
+    while (!ps->failed && *ps->p == '|') {
+        ps->p++;
+        NFA_FRAG right = parse_concat(ps);
+        int end = nfa_add(ps, NFA_EPS, -1, -1);
+        int split = nfa_add(ps, NFA_SPLIT, f.start, right.start);
+        if (ps->failed) {
+            break;
+        }
+        ps->re->nfa[f.end].out = end;
+        ps->re->nfa[right.end].out = end;
+        f.start = split;
+        f.end = end;
+    }
+    return f;
+}
+
+/* Extracts the literal every match must start with. Returns nothing when the pattern has a
+   top-level '|' or does not begin with a literal byte. */
+static int extract_prefix(REGEX * re, const char * pattern)
+{
+    const char * p = pattern;
+    int depth = 0;
+
+    // a top-level alternation means there is no common prefix
+    for (const char * q = pattern; *q; q++) {
+        if (*q == '\\' && q[1]) {
+            q++;
+        }
+        else if (*q == '[') {
+            q++;
+            if (*q == '^') q++;
+            if (*q == ']') q++;
+            while (*q && *q != ']') {
+                if (*q == '\\' && q[1]) q++;
+                q++;
+            }
+            if (!*q) break;
+        }
+        else if (*q == '(') depth++;
+        else if (*q == ')') depth--;
+        else if (*q == '|' && depth == 0) return 0;
+    }
+
+    re->prefix = malloc(strlen(pattern) + 1);
+    if (!re->prefix) {
+        return -1;
+    }
+    re->prefix_len = 0;
+
+    if (*p == '^') {
+        re->anchored = 1;
+        p++;
+    }
+    while (*p) {
+        int c;
+        const char * next;
+
+        if (*p == '\\' && p[1] && !strchr("dwsDWS", p[1])) {
+            c = escaped_byte(p[1]);
+            next = p + 2;
+        }
+        else if (*p && !strchr(".[]()|*+?^$\\", *p)) {
+            c = (unsigned char)*p;
+            next = p + 1;
+        }
+        else {
+            break;
+        }
+
+        // a literal followed by '*' or '?' is optional and ends the prefix without being part of it
+        if (*next == '*' || *next == '?') {
+            break;
+        }
+        re->prefix[re->prefix_len++] = c;
+        if (*next == '+') {
+            break;
+        }
+        p = next;
+    }
+    return 0;
+}
+
+/* ----- Lazy DFA ----- */
+
+static void dfa_flush(REGEX * re)
+{
+    if (re->bytes_since_flush < (size_t)DFA_MIN_BYTES_PER_STATE * re->state_num) {
+        re->nfa_only = 1;
+    }
+    re->bytes_since_flush = 0;
+    re->state_num = 0;
+    re->mem_used = 0;
+    for (int i = 0; i < re->hash_cap; i++) {
+        re->hash[i] = -1;
+    }
+    re->start_state[0] = re->start_state[1] = DFA_UNKNOWN;
+    re->flush_count++;
+}
+
+static unsigned int dfa_hash(const int * nfa, int nfa_num, int flags)
+{
+    unsigned int h = 2166136261u ^ flags;
+    for (int i = 0; i < nfa_num; i++) {
+        h = (h ^ nfa[i]) * 16777619u;
+    }
+    return h;
+}
+
+static int compare_int(const void * a, const void * b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Follows epsilon edges from the seeds and writes the reachable SET/EOL/MATCH states to out.
+   BOL edges are followed only when bol is set, EOL edges only when eol is set.
+   @ret: the number of states written. */
+static int nfa_closure(REGEX * re, const int * seeds, int seed_num, int bol, int eol, int * out)
+{
+    int top = 0, num = 0;
+
+    re->mark_gen++;
+    for (int i = 0; i < seed_num; i++) {
+        re->stack[top++] = seeds[i];
+    }
+    while (top > 0) {
+        int s = re->stack[--top];
+        if (s < 0 || re->mark[s] == re->mark_gen) {
+            continue;
+        }
+        re->mark[s] = re->mark_gen;
+
+        NFA_STATE * st = &re->nfa[s];
+        switch (st->type) {
+        case NFA_SPLIT:
+            re->stack[top++] = st->out1;
+            re->stack[top++] = st->out;
+            break;
+        case NFA_EPS:
+            re->stack[top++] = st->out;
+            break;
+        case NFA_BOL:
+            if (bol) re->stack[top++] = st->out;
+            break;
+        case NFA_EOL:
+            if (eol) re->stack[top++] = st->out;
+            else out[num++] = s;
+            break;
+        default:  // NFA_SET, NFA_MATCH
+            out[num++] = s;
+            break;
+        }
+    }
+    return num;
+}
+
+/* Returns the index of the DFA state for the NFA set, creating it (and flushing the cache when it is
+   over the memory cap) if needed. nfa is sorted in place. @ret: the state index, or -1 on error. */
+static int dfa_state_for(REGEX * re, int * nfa, int nfa_num, int bol)
+{
+    int flags = bol ? DFA_BOL : 0;
+
+    qsort(nfa, nfa_num, sizeof(int), compare_int);
+
+    unsigned int mask = re->hash_cap - 1;
+    unsigned int h = dfa_hash(nfa, nfa_num, flags) & mask;
+    while (re->hash[h] >= 0) {
+        DFA_STATE * s = re->states[re->hash[h]];
+        if ((s->flags & DFA_BOL) == flags && s->nfa_num == nfa_num &&
+            !memcmp(s->nfa, nfa, nfa_num * sizeof(int))) {
+            return re->hash[h];
+        }
+        h = (h + 1) & mask;
+    }
+
+    // keep every state int aligned inside the arena
+    size_t size = (sizeof(DFA_STATE) + nfa_num * sizeof(int) + sizeof(int) - 1) & ~(sizeof(int) - 1);
+    if (re->state_num == re->state_cap || re->mem_used + size > re->mem_cap) {
+        dfa_flush(re);
+        h = dfa_hash(nfa, nfa_num, flags) & mask;
+    }
+
+    DFA_STATE * s = (DFA_STATE *)(re->arena + re->mem_used);
+    for (int c = 0; c < 256; c++) {
+        s->next[c] = DFA_UNKNOWN;
+    }
+    s->nfa_num = nfa_num;
+    memcpy(s->nfa, nfa, nfa_num * sizeof(int));
+
+    for (int i = 0; i < nfa_num; i++) {
+        if (re->nfa[nfa[i]].type == NFA_MATCH) {
+            flags |= DFA_MATCH;
+        }
+    }
+    // at the end of the line the pending '$' edges may lead to a match
+    int eol_num = nfa_closure(re, nfa, nfa_num, bol, 1, re->work);
+    for (int i = 0; i < eol_num; i++) {
+        if (re->nfa[re->work[i]].type == NFA_MATCH) {
+            flags |= DFA_EOL_MATCH;
+        }
+    }
+    s->flags = flags;
+
+    int idx = re->state_num++;
+    re->states[idx] = s;
+    re->hash[h] = idx;
+    re->mem_used += size;
+    return idx;
+}
+
+static int dfa_start(REGEX * re, int bol)
+{
+    if (re->start_state[bol] == DFA_UNKNOWN) {
+        int num = nfa_closure(re, &re->start, 1, bol, 0, re->closure);
+        re->start_state[bol] = dfa_state_for(re, re->closure, num, bol);
+    }
+    return re->start_state[bol];
+}
+
+/* Builds the transition from state on byte c. The unanchored search is folded into the DFA by
+   adding the start state to every step, so a match may begin at any position. */
+static int dfa_step(REGEX * re, int state, unsigned char c)
+{
+    DFA_STATE * s = re->states[state];
+    int seed_num = 0;
+    int * seeds = re->work;
+
+    for (int i = 0; i < s->nfa_num; i++) {
+        NFA_STATE * st = &re->nfa[s->nfa[i]];
+        if (st->type == NFA_SET && (re->sets[st->set][c >> 3] & (1 << (c & 7)))) {
+            seeds[seed_num++] = st->out;
+        }
+    }
+    seeds[seed_num++] = re->start;
+
+    int num = nfa_closure(re, seeds, seed_num, 0, 0, re->closure);
+
+    int flushes = re->flush_count;
+    int next = dfa_state_for(re, re->closure, num, 0);
+
+    // cache the edge unless the source state was just flushed away
+    if (next >= 0 && flushes == re->flush_count) {
+        s->next[c] = next;
+    }
+    return next;
+}
+
+REGEX * regex_compile(const char * pattern, size_t dfa_mem_cap, char * err, size_t err_len)
+{
+    REGEX * re = calloc(1, sizeof(REGEX));
+    PARSER ps;
+
+    if (!re) {
+        snprintf(err, err_len, "out of memory");
+        return NULL;
+    }
+
+    ps.re = re;
+    ps.pattern = pattern;
+    ps.p = pattern;
+    ps.err = err;
+    ps.err_len = err_len;
+    ps.failed = 0;
+
+    NFA_FRAG f = parse_alt(&ps);
+    if (!ps.failed && *ps.p) {
+        parse_error(&ps, "unmatched ')'");
+    }
+    if (!ps.failed) {
+        re->nfa[f.end].out = nfa_add(&ps, NFA_MATCH, -1, -1);
+        re->start = f.start;
+    }
+    if (ps.failed || extract_prefix(re, pattern) < 0) {
+        if (!ps.failed) {
+            snprintf(err, err_len, "out of memory");
+        }
+        regex_free(re);
+        return NULL;
+    }
+
+    // the cache must at least fit the largest possible state (one holding every NFA state)
+    re->mem_cap = dfa_mem_cap;
+    if (re->mem_cap < sizeof(DFA_STATE) + re->nfa_num * sizeof(int) + sizeof(int)) {
+        re->mem_cap = sizeof(DFA_STATE) + re->nfa_num * sizeof(int) + sizeof(int);
+    }
+    re->state_cap = re->mem_cap / sizeof(DFA_STATE) + 1;
+    re->hash_cap = 1;
+    while (re->hash_cap < 2 * re->state_cap) {
+        re->hash_cap <<= 1;
+    }
+    re->arena = malloc(re->mem_cap);
+    re->states = malloc(re->state_cap * sizeof(*re->states));
+    re->hash = malloc(re->hash_cap * sizeof(*re->hash));
+    // a closure pushes its seeds (at most nfa_num + 1) plus two edges per visited state
+    re->stack = malloc((3 * re->nfa_num + 1) * sizeof(int));
+    re->mark = calloc(re->nfa_num, sizeof(int));
+    re->work = malloc((re->nfa_num + 1) * sizeof(int));
+    re->closure = malloc(re->nfa_num * sizeof(int));
+    re->closure2 = malloc(re->nfa_num * sizeof(int));
+    if (!re->arena || !re->states || !re->hash || !re->stack || !re->mark || !re->work ||
+        !re->closure || !re->closure2) {
+        snprintf(err, err_len, "out of memory");
+        regex_free(re);
+        return NULL;
+    }
+    for (int i = 0; i < re->hash_cap; i++) {
+        re->hash[i] = -1;
+    }
+    re->start_state[0] = re->start_state[1] = DFA_UNKNOWN;
+
+    // build the start states now so every forked map worker inherits them
+    if (dfa_start(re, 0) < 0 || dfa_start(re, 1) < 0) {
+        snprintf(err, err_len, "out of memory");
+        regex_free(re);
+        return NULL;
+    }
+
+    return re;
+}
+
+static int nfa_has_match(REGEX * re, const int * set, int num)
+{
+    for (int k = 0; k < num; k++) {
+        if (re->nfa[set[k]].type == NFA_MATCH) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Direct NFA simulation from position i: the same steps as dfa_step, without caching the sets */
+static int nfa_match_line(REGEX * re, const char * line, size_t len, size_t i)
+{
+    int * cur = re->closure, * next = re->closure2;
+    int num = nfa_closure(re, &re->start, 1, i == 0, 0, cur);
+
+    for (; i < len; i++) {
+        if (nfa_has_match(re, cur, num)) {
+            return 1;
+        }
+
+        unsigned char c = line[i];
+        int seed_num = 0;
+        for (int k = 0; k < num; k++) {
+            NFA_STATE * st = &re->nfa[cur[k]];
+            if (st->type == NFA_SET && (re->sets[st->set][c >> 3] & (1 << (c & 7)))) {
+                re->work[seed_num++] = st->out;
+            }
+        }
+        re->work[seed_num++] = re->start;
+        num = nfa_closure(re, re->work, seed_num, 0, 0, next);
+
+        int * tmp = cur;
+        cur = next;
+        next = tmp;
+    }
+
+    memcpy(re->work, cur, num * sizeof(int));
+    num = nfa_closure(re, re->work, num, len == 0, 1, cur);
+    return nfa_has_match(re, cur, num);
+}
+
+int regex_match_line(REGEX * re, const char * line, size_t len)
+{
+    size_t i = 0;
+
+    // prefilter: a match must start with the literal prefix
+    if (re->prefix_len > 0) {
+        if (re->anchored) {
+            if (len < re->prefix_len || memcmp(line, re->prefix, re->prefix_len)) {
+                return 0;
+            }
+        }
+        else {
+            const char * hit = memmem(line, len, re->prefix, re->prefix_len);
+            if (!hit) {
+                return 0;
+            }
+            i = hit - line;
+        }
+    }
+
+    if (re->nfa_only) {
+        return nfa_match_line(re, line, len, i);
+    }
+    re->bytes_since_flush += len - i;
+
+    int state = dfa_start(re, i == 0);
+    if (state < 0) {
+        return -1;
+    }
+    for (; i < len; i++) {
+        DFA_STATE * s = re->states[state];
+        if (s->flags & DFA_MATCH) {
+            return 1;
+        }
+        if (s->nfa_num == 0) {
+            return 0;  // dead state: only reachable for anchored patterns
+        }
+
+        unsigned char c = line[i];
+        state = s->next[c] != DFA_UNKNOWN ? s->next[c] : dfa_step(re, state, c);
+        if (state < 0) {
+            return -1;
+        }
+    }
+    return (re->states[state]->flags & (DFA_MATCH | DFA_EOL_MATCH)) ? 1 : 0;
+}
+
+void regex_free(REGEX * re)
+{
+    if (!re) {
+        return;
+    }
+    free(re->states);
+    free(re->arena);
+    free(re->hash);
+    free(re->stack);
+    free(re->mark);
+    free(re->work);
+    free(re->closure);
+    free(re->closure2);
+    free(re->prefix);
+    free(re->nfa);
+    free(re->sets);
+    free(re);
+}
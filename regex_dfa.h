@@ -0,0 +1,28 @@
+/* Line-oriented regular expression matcher backed by a lazily built DFA */
+
+#ifndef _REGEX_DFA_H
+#define _REGEX_DFA_H
+
+#include <stddef.h>
+
+#define REGEX_DEFAULT_DFA_MEM (8 << 20) /* Default cap (in bytes) on the cached DFA states */
+
+typedef struct _regex REGEX;
+
+/* Compiles pattern into an NFA and prepares its DFA cache.
+   Supported syntax: literals, '.', [...] and [^...] classes with ranges, \d \w \s \D \W \S,
+   \t \n \r, escaped punctuation, (...) groups, '|', '*', '+', '?', and the '^'/'$' line anchors.
+   Other escapes (\b, \1, ...) and '{n,m}' repetition are rejected; write "\{" for a literal brace.
+   Matching is byte based; '.' and negated classes match single bytes.
+   @param dfa_mem_cap: The memory (in bytes) the DFA cache may use before it is flushed.
+   @param err: Receives a message when the pattern is invalid.
+   @ret: the compiled regex, or NULL on error. */
+REGEX * regex_compile(const char * pattern, size_t dfa_mem_cap, char * err, size_t err_len);
+
+/* @ret: 1 if the regex matches anywhere in line[0..len), 0 otherwise. */
+int regex_match_line(REGEX * re, const char * line, size_t len);
+
+void regex_free(REGEX * re);
+
+
+#endif
@@ -4,7 +4,15 @@ make
 
 # ./run-mapreduce "counter" ./input-warpeace.txt 4
 # ./run-mapreduce "finder" ./input-alice30.txt 4 Alice
+# ./run-mapreduce "finder-n" ./input-alice30.txt 4 Alice
 # ./run-mapreduce "finder" ./input-warpeace.txt 4 war
+# ./run-mapreduce "regex" ./input-alice30.txt 4 "the (Queen|King)"
 
 # ./run-mapreduce "counter" ./input-moon10.txt 4
+# ./run-mapreduce "charfreq" ./input-moon10.txt 4 fold
+# ./run-mapreduce "topk" ./input-moon10.txt 4 20
+
+# ./run-mapreduce-typed "counter" ./input-moon10.txt 4
+# ./run-mapreduce-typed "c-finder" ./input-alice30.txt 4 Alice
+# ./run-mapreduce-typed "c-topk" ./input-alice30.txt 4 10
 
@@ -0,0 +1,100 @@
+/* Test driver for the typed C++ jobs in usr_functions.hpp and, through the adapter, the C jobs */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mapreduce.hpp"
+#include "usr_functions.hpp"
+#include "usr_functions.h"
+
+static void print_usage(const char * cmd_name)
+{
+    printf("Usage: %s \"counter\"|\"words\"|\"c-counter\"|\"c-finder\" file_path split_num [word_to_find]\n", cmd_name);
+    printf("       %s \"c-topk\" file_path split_num [k]\n", cmd_name);
+}
+
+/* Writes the pairs to the result file, one "<key> <value>" line each */
+template <class Pairs, class FormatKey>
+static void write_result(const char * path, const Pairs & pairs, FormatKey format_key)
+{
+    FILE * out = fopen(path, "w");
+    if (NULL == out) {
+        printf("Cannot create result file %s\n", path);
+        exit(2);
+    }
+    for (const auto & kv : pairs) {
+        fprintf(out, "%s %ld\n", format_key(kv.first).c_str(), kv.second);
+    }
+    fclose(out);
+}
+
+/* reduce_worker_pid is 0 for typed jobs, which merge in the coordinator instead of a reduce worker */
+static void print_result(const char * path, const std::vector<int> & map_worker_pid, int reduce_worker_pid, int processing_time)
+{
+    printf("***** RESULT ***** \n");
+    printf("Result file: %s\n", path);
+
+    printf("Map worker pids: ");
+    for (int pid : map_worker_pid) printf("%d ", pid);
+    printf("\n");
+
+    if (reduce_worker_pid > 0) {
+        printf("Reduce worker pid: %d\n", reduce_worker_pid);
+    }
+    else {
+        printf("Reduce worker pid: none (reduced in the coordinator)\n");
+    }
+    printf("Processing time (us): %d\n", processing_time);
+}
+
+int main(int argc, char * argv[])
+{
+    const char * result_path = "mr.rst";
+
+    setbuf(stdout, NULL); // no bufferring for stdio
+
+    if (argc < 4 || atoi(argv[3]) <= 0) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+    const char * input_path = argv[2];
+    int split_num = atoi(argv[3]);
+
+    if (!strcmp(argv[1], "counter")) {
+        mr::Result<unsigned int, long> res = LetterCounter().run(input_path, split_num);
+        write_result(result_path, res.pairs, [](unsigned int k) { return std::string(1, 'A' + k); });
+        print_result(result_path, res.map_worker_pid, 0, res.processing_time);
+    }
+    else if (!strcmp(argv[1], "words")) {
+        mr::Result<std::string, long> res = WordCounter().run(input_path, split_num);
+        write_result(result_path, res.pairs, [](const std::string & k) { return k; });
+        print_result(result_path, res.map_worker_pid, 0, res.processing_time);
+    }
+    else if (!strcmp(argv[1], "c-counter")) {
+        mr::CJobResult res = mr::run_c_job(letter_counter_map, letter_counter_reduce, NULL,
+                                           input_path, split_num, result_path);
+        print_result(result_path, res.map_worker_pid, res.reduce_worker_pid, res.processing_time);
+    }
+    else if (!strcmp(argv[1], "c-finder") && argc >= 5) {
+        mr::CJobResult res = mr::run_c_job(word_finder_map, word_finder_reduce, argv[4],
+                                           input_path, split_num, result_path);
+        print_result(result_path, res.map_worker_pid, res.reduce_worker_pid, res.processing_time);
+    }
+    else if (!strcmp(argv[1], "c-topk")) {
+        const char * k = argc >= 5 ? argv[4] : "10";
+        if (atoi(k) <= 0) {
+            print_usage(argv[0]);
+            exit(1);
+        }
+        mr::CJobResult res = mr::run_c_job(topk_map, topk_reduce, const_cast<char *>(k),
+                                           input_path, split_num, result_path, topk_flush);
+        print_result(result_path, res.map_worker_pid, res.reduce_worker_pid, res.processing_time);
+    }
+    else {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    exit(0);
+}
@@ -13,8 +13,10 @@
 #include <fcntl.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 #include "common.h"
 #include "usr_functions.h"
+#include "regex_dfa.h"
 
 #define MAX_LINE_LENGTH 4096
 #define BUFFER_SIZE 4096
@@ -80,7 +82,7 @@ int letter_counter_map(DATA_SPLIT * split, int fd_out)
 {
     // add your implementation here ...
     char buffer[BUFFER_SIZE];
-    ssize_t bytes_read;
+    ssize_t bytes_read = 0;
     int letter_counts[26] = {0}; // Array to store counts for A-Z
     
     // Read and process the split in chunks
@@ -188,7 +190,7 @@ int word_finder_map(DATA_SPLIT * split, int fd_out)
     char *line = malloc(MAX_LINE_LENGTH);
     char *word_to_find = (char *)split->usr_data;
     char buffer[BUFFER_SIZE];
-    ssize_t bytes_read;
+    ssize_t bytes_read = 0;
     size_t pos = 0;
     size_t remaining = split->size;
     
@@ -320,3 +322,1109 @@ int word_finder_reduce(int * p_fd_in, int fd_in_num, int fd_out)
 }
 
 
+
+
+/* Buffered line reader over an intermediate file; it also reports where each line starts. */
+typedef struct _line_reader
+{
+    int fd;
+    char buf[BUFFER_SIZE];
+    ssize_t len;   /* valid bytes in buf */
+    ssize_t idx;   /* next unread byte in buf */
+    off_t pos;     /* file offset of buf[idx] */
+}LINE_READER;
+
+static void line_reader_init(LINE_READER * reader, int fd, off_t start)
+{
+    reader->fd = fd;
+    reader->len = 0;
+    reader->idx = 0;
+    reader->pos = start;
+    lseek(fd, start, SEEK_SET);
+}
+
+/* Reads the next line (without '\n') into line, truncating it to cap - 1 bytes.
+   @ret: 1 if a line was read, 0 at EOF, -1 on error. *line_start gets the file offset of the line. */
+static int line_reader_next(LINE_READER * reader, char * line, size_t cap, off_t * line_start)
+{
+    size_t pos = 0;
+    int got_any = 0;
+
+    *line_start = reader->pos;
+    for (;;) {
+        if (reader->idx == reader->len) {
+            reader->len = read(reader->fd, reader->buf, BUFFER_SIZE);
+            reader->idx = 0;
+            if (reader->len < 0) {
+                return -1;
+            }
+            if (reader->len == 0) {
+                line[pos] = '\0';
+                return got_any;
+            }
+        }
+
+        char c = reader->buf[reader->idx++];
+        reader->pos++;
+        got_any = 1;
+        if (c == '\n') {
+            line[pos] = '\0';
+            return 1;
+        }
+        if (pos < cap - 1) {
+            line[pos++] = c;
+        }
+    }
+}
+
+/* Writes one annotated match record: "M <line index in split> <line offset in input> <text>\n" */
+static int write_annotated_match(int fd_out, long line_idx, long long line_off, const char * line, size_t len)
+{
+    char header[64];
+    int n = snprintf(header, sizeof(header), "M %ld %lld ", line_idx, line_off);
+
+    if (write(fd_out, header, n) < 0 || write(fd_out, line, len) < 0 || write(fd_out, "\n", 1) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+/* User-defined map function for the annotated "Word finder" task ("finder-n").
+   Works like word_finder_map, but every matching line is tagged with its line index relative to the
+   start of the split and its byte offset in the input, and the newline count of the split is written
+   as a trailer:
+       M <line index> <line offset> <text>
+       ...
+       S <split offset> <newline count>
+   A map worker may process several splits (streaming mode), each one ends with its own "S" record.
+   @param split: The data split that the map function is going to work on.
+   @param fd_out: The file descriptor of the itermediate data file output by the map function.
+   @ret: 0 on success, -1 on error.
+ */
+int word_finder_annotated_map(DATA_SPLIT * split, int fd_out)
+{
+    char *line = malloc(MAX_LINE_LENGTH);
+    char *word_to_find = (char *)split->usr_data;
+    char buffer[BUFFER_SIZE];
+    ssize_t bytes_read = 0;
+    size_t pos = 0;
+    size_t remaining = split->size;
+    long newlines = 0;          // newlines seen so far in this split
+    long long consumed = 0;     // bytes of the split consumed so far
+    long long line_start = 0;   // split-relative offset of the line being assembled
+    int ret = 0;
+
+    if (!line) {
+        return -1;
+    }
+
+    while (remaining > 0 && (bytes_read = read(split->fd, buffer,
+           remaining < BUFFER_SIZE ? remaining : BUFFER_SIZE)) > 0) {
+
+        for (ssize_t i = 0; i < bytes_read && ret == 0; i++, consumed++) {
+            if (pos >= MAX_LINE_LENGTH - 1) {
+                // Line too long: check the piece and continue with the rest of the same line,
+                // whose records keep the offset of the line's start
+                line[pos] = '\0';
+                if (find_word(line, word_to_find)) {
+                    ret = write_annotated_match(fd_out, newlines, split->offset + line_start, line, pos);
+                }
+                pos = 0;
+            }
+
+            if (buffer[i] == '\n') {
+                line[pos] = '\0';
+                if (find_word(line, word_to_find)) {
+                    ret = write_annotated_match(fd_out, newlines, split->offset + line_start, line, pos);
+                }
+                newlines++;
+                line_start = consumed + 1;
+                pos = 0;
+            } else {
+                line[pos++] = buffer[i];
+            }
+        }
+
+        remaining -= bytes_read;
+    }
+
+    // Process last line if it exists
+    if (ret == 0 && pos > 0) {
+        line[pos] = '\0';
+        if (find_word(line, word_to_find)) {
+            ret = write_annotated_match(fd_out, newlines, split->offset + line_start, line, pos);
+        }
+    }
+
+    if (ret == 0) {
+        char trailer[64];
+        int n = snprintf(trailer, sizeof(trailer), "S %lld %ld\n", split->offset, newlines);
+        if (write(fd_out, trailer, n) < 0) {
+            ret = -1;
+        }
+    }
+
+    free(line);
+    return (bytes_read < 0) ? -1 : ret;
+}
+
+/* User-defined reduce function for the annotated "Word finder" task ("finder-n").
+   The intermediate data arrives in input order (one file per split, or a streamed job's chunks in
+   stream order), so a running sum over the "S" trailers' newline counts gives each split's first
+   line number. The records are rewritten as
+       <line number>:<byte offset>:<text>
+   with 1-based line numbers and the byte offset of the start of the line, like "grep -n -b".
+   @param p_fd_in: The address of the buffer holding the intermediate data files' file descriptors.
+   @param fd_in_num: The number of the intermediate files.
+   @param fd_out: The file descriptor of the final result file.
+   @ret: 0 on success, -1 on error.
+*/
+int word_finder_annotated_reduce(int * p_fd_in, int fd_in_num, int fd_out)
+{
+    const size_t line_cap = MAX_LINE_LENGTH + 64;
+    char *line = malloc(line_cap);
+    LINE_READER *reader = malloc(sizeof(LINE_READER));
+    long line_base = 0;   // newlines in all earlier splits
+    int ret = 0;
+
+    if (!line || !reader) {
+        free(line);
+        free(reader);
+        return -1;
+    }
+
+    for (int i = 0; i < fd_in_num && ret == 0; i++) {
+        off_t line_start;
+        int r = 0;
+
+        line_reader_init(reader, p_fd_in[i], 0);
+        while (ret == 0 && (r = line_reader_next(reader, line, line_cap, &line_start)) > 0) {
+            long line_idx, newlines;
+            long long line_off;
+            int text_pos = 0;
+
+            if (line[0] == 'S') {
+                if (sscanf(line, "S %lld %ld", &line_off, &newlines) != 2) {
+                    ret = -1;
+                }
+                line_base += newlines;
+                continue;
+            }
+            // the text follows the single space after the offset and may itself start with spaces
+            if (sscanf(line, "M %ld %lld%n", &line_idx, &line_off, &text_pos) != 2 || line[text_pos] != ' ') {
+                ret = -1;
+                break;
+            }
+            text_pos++;
+
+            char header[64];
+            int n = snprintf(header, sizeof(header), "%ld:%lld:", line_base + line_idx + 1, line_off);
+            if (write(fd_out, header, n) < 0 ||
+                write(fd_out, line + text_pos, strlen(line + text_pos)) < 0 ||
+                write(fd_out, "\n", 1) < 0) {
+                ret = -1;
+            }
+        }
+        if (r < 0) {
+            ret = -1;
+        }
+    }
+
+    free(reader);
+    free(line);
+    return ret;
+}
+
+
+/* ----- "Character frequency" task: UTF-8 code point counting ----- */
+
+/* Sequence length for each lead byte, 0 for bytes that can never start a sequence
+   (continuation bytes, overlong C0/C1 leads, and F5..FF) */
+static const unsigned char utf8_seq_len[256] = {
+    [0x00 ... 0x7F] = 1,
+    [0xC2 ... 0xDF] = 2,
+    [0xE0 ... 0xEF] = 3,
+    [0xF0 ... 0xF4] = 4,
+};
+
+/* Valid range of the byte after each lead byte; the narrower ranges reject overlong
+   forms (E0, F0), UTF-16 surrogates (ED) and code points above U+10FFFF (F4) */
+static const unsigned char utf8_second_min[256] = {
+    [0xC2 ... 0xF4] = 0x80,
+    [0xE0] = 0xA0,
+    [0xF0] = 0x90,
+};
+static const unsigned char utf8_second_max[256] = {
+    [0xC2 ... 0xF4] = 0xBF,
+    [0xED] = 0x9F,
+    [0xF4] = 0x8F,
+};
+
+/* Payload bits of the lead byte, indexed by sequence length */
+static const unsigned char utf8_lead_mask[5] = { 0, 0x7F, 0x1F, 0x0F, 0x07 };
+
+#define UTF8_REPLACEMENT 0xFFFD
+#define ASCII_HIGH_BITS 0x8080808080808080ULL
+
+/* Open-addressing hash of code point -> count. Key 0 marks an empty slot,
+   which is safe because U+0000 is never counted. */
+typedef struct _cp_table
+{
+    unsigned int * keys;
+    long * counts;
+    size_t cap;   /* always a power of two */
+    size_t used;
+}CP_TABLE;
+
+static int cp_table_init(CP_TABLE * table, size_t cap)
+{
+    table->keys = calloc(cap, sizeof(*table->keys));
+    table->counts = calloc(cap, sizeof(*table->counts));
+    table->cap = cap;
+    table->used = 0;
+    return (table->keys && table->counts) ? 0 : -1;
+}
+
+static void cp_table_free(CP_TABLE * table)
+{
+    free(table->keys);
+    free(table->counts);
+}
+
+static int cp_table_add(CP_TABLE * table, unsigned int cp, long count);
+
+static int cp_table_grow(CP_TABLE * table)
+{
+    CP_TABLE bigger;
+
+    if (cp_table_init(&bigger, table->cap * 2) < 0) {
+        cp_table_free(&bigger);
+        return -1;
+    }
+    for (size_t i = 0; i < table->cap; i++) {
+        if (table->keys[i]) {
+            cp_table_add(&bigger, table->keys[i], table->counts[i]);
+        }
+    }
+    cp_table_free(table);
+    *table = bigger;
+    return 0;
+}
+
+static int cp_table_add(CP_TABLE * table, unsigned int cp, long count)
+{
+    size_t mask = table->cap - 1;
+    size_t i = (cp * 2654435761u) & mask;
+
+    while (table->keys[i] && table->keys[i] != cp) {
+        i = (i + 1) & mask;
+    }
+    if (!table->keys[i]) {
+        table->keys[i] = cp;
+        table->used++;
+    }
+    table->counts[i] += count;
+
+    // keep the load factor under 70%
+    if (table->used * 10 > table->cap * 7) {
+        return cp_table_grow(table);
+    }
+    return 0;
+}
+
+/* Simple case folding (Unicode CaseFolding.txt status C and S) for ASCII, Latin-1, Latin Extended-A,
+   Greek and Coptic (U+0370..U+03FF), Cyrillic (U+0400..U+04FF) and Cyrillic Supplement (U+0500..U+052F).
+   Code points outside those blocks are returned unchanged. */
+static unsigned int fold_case(unsigned int cp)
+{
+    if (cp >= 'A' && cp <= 'Z') return cp + 0x20;
+    if (cp == 0xB5) return 0x3BC;                              // micro sign -> small mu
+    if (cp < 0xC0) return cp;
+    if (cp <= 0xDE) return cp == 0xD7 ? cp : cp + 0x20;        // Latin-1 (except the multiplication sign)
+    if (cp == 0x130 || cp == 0x131) return cp;                 // dotted I / dotless i only fold in Turkic locales
+    if (cp >= 0x100 && cp <= 0x137) return cp | 1;             // Latin Extended-A: even upper, odd lower
+    if (cp >= 0x139 && cp <= 0x148) return (cp & 1) ? cp + 1 : cp;
+    if (cp >= 0x14A && cp <= 0x177) return cp | 1;
+    if (cp == 0x178) return 0xFF;
+    if (cp >= 0x179 && cp <= 0x17E) return (cp & 1) ? cp + 1 : cp;
+    if (cp == 0x17F) return 's';                               // long s
+    if (cp == 0x345) return 0x3B9;                             // combining ypogegrammeni -> iota
+    if (cp >= 0x370 && cp <= 0x377) return (cp == 0x374) ? cp : cp | 1;  // heta, archaic sampi, pamphylian digamma
+    if (cp == 0x37F) return 0x3F3;                             // yot
+    if (cp == 0x386) return 0x3AC;                             // capitals with tonos
+    if (cp >= 0x388 && cp <= 0x38A) return cp + 0x25;
+    if (cp == 0x38C) return 0x3CC;
+    if (cp == 0x38E || cp == 0x38F) return cp + 0x3F;
+    if (cp >= 0x391 && cp <= 0x3AB) return cp == 0x3A2 ? cp : cp + 0x20;  // Greek capitals
+    switch (cp) {                                              // final sigma and symbol variants
+    case 0x3C2: return 0x3C3;
+    case 0x3CF: return 0x3D7;
+    case 0x3D0: return 0x3B2;
+    case 0x3D1: return 0x3B8;
+    case 0x3D5: return 0x3C6;
+    case 0x3D6: return 0x3C0;
+    case 0x3F0: return 0x3BA;
+    case 0x3F1: return 0x3C1;
+    case 0x3F4: return 0x3B8;
+    case 0x3F5: return 0x3B5;
+    case 0x3F7: return 0x3F8;
+    case 0x3F9: return 0x3F2;
+    case 0x3FA: return 0x3FB;
+    }
+    if (cp >= 0x3D8 && cp <= 0x3EF) return cp | 1;            // archaic letters and Coptic: even upper, odd lower
+    if (cp >= 0x3FD && cp <= 0x3FF) return cp - 0x82;          // reversed lunate sigmas
+    if (cp >= 0x400 && cp <= 0x40F) return cp + 0x50;          // Cyrillic capitals
+    if (cp >= 0x410 && cp <= 0x42F) return cp + 0x20;
+    if (cp >= 0x460 && cp <= 0x481) return cp | 1;             // historic letters: even upper, odd lower
+    if (cp >= 0x48A && cp <= 0x4BF) return cp | 1;
+    if (cp == 0x4C0) return 0x4CF;                             // palochka
+    if (cp >= 0x4C1 && cp <= 0x4CE) return (cp & 1) ? cp + 1 : cp;
+    if (cp >= 0x4D0 && cp <= 0x52F) return cp | 1;
+    return cp;
+}
+
+/* Whitespace (including the Unicode space separators, NEL and the line/paragraph separators)
+   and control characters (C0, DEL, C1) are not counted */
+static int is_counted_code_point(unsigned int cp)
+{
+    if (cp <= 0x20 || (cp >= 0x7F && cp <= 0xA0)) return 0;   // C0, space, DEL, C1 (incl. NEL), no-break space
+    if (cp < 0x1680) return 1;
+    return !(cp == 0x1680 || (cp >= 0x2000 && cp <= 0x200A) || cp == 0x2028 || cp == 0x2029 ||
+             cp == 0x202F || cp == 0x205F || cp == 0x3000);
+}
+
+/* Decodes one multibyte sequence starting at buf[0], with n bytes available.
+   @ret: the sequence length, 0 if the sequence is valid so far but truncated by the end of buf,
+         or 1 with *cp = U+FFFD for an invalid lead or continuation byte. */
+static int utf8_decode(const unsigned char * buf, size_t n, unsigned int * cp)
+{
+    unsigned char lead = buf[0];
+    int len = utf8_seq_len[lead];
+
+    *cp = UTF8_REPLACEMENT;
+    if (len == 0) {
+        return 1;
+    }
+    if (n < 2) {
+        return 0;
+    }
+    if (buf[1] < utf8_second_min[lead] || buf[1] > utf8_second_max[lead]) {
+        return 1;
+    }
+
+    unsigned int value = ((lead & utf8_lead_mask[len]) << 6) | (buf[1] & 0x3F);
+    for (int k = 2; k < len; k++) {
+        if ((size_t)k >= n) {
+            return 0;
+        }
+        if ((buf[k] & 0xC0) != 0x80) {
+            return 1;
+        }
+        value = (value << 6) | (buf[k] & 0x3F);
+    }
+    *cp = value;
+    return len;
+}
+
+static int utf8_encode(unsigned int cp, char * out)
+{
+    if (cp < 0x80) {
+        out[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = 0xC0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = 0xE0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3F);
+        out[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3F);
+    out[2] = 0x80 | ((cp >> 6) & 0x3F);
+    out[3] = 0x80 | (cp & 0x3F);
+    return 4;
+}
+
+/* User-defined map function for the "Character frequency" task.
+   Decodes the split as UTF-8 and counts every code point except whitespace and control characters;
+   malformed bytes are counted as U+FFFD. Runs of 8 ASCII bytes are detected with one 64-bit test and
+   counted straight into a 128-entry array, only non-ASCII bytes go through the table-driven decoder
+   and the code point hash. If split->usr_data is not NULL, counts are case folded before being written.
+   Intermediate output is one "<hex code point> <count>" line per distinct code point.
+   @param split: The data split that the map function is going to work on.
+   @param fd_out: The file descriptor of the itermediate data file output by the map function.
+   @ret: 0 on success, -1 on error.
+ */
+int char_freq_map(DATA_SPLIT * split, int fd_out)
+{
+    unsigned char buffer[BUFFER_SIZE + 4];   // room for an incomplete sequence carried from the last read
+    long ascii_counts[128] = {0};
+    CP_TABLE table;
+    ssize_t bytes_read = 0;
+    size_t carry = 0;
+    size_t remaining = split->size;
+    int ret = 0;
+
+    if (cp_table_init(&table, 256) < 0) {
+        cp_table_free(&table);
+        return -1;
+    }
+
+    while (ret == 0 && (remaining > 0 || carry > 0)) {
+        bytes_read = 0;
+        if (remaining > 0) {
+            bytes_read = read(split->fd, buffer + carry, remaining < BUFFER_SIZE ? remaining : BUFFER_SIZE);
+            if (bytes_read < 0) {
+                ret = -1;
+                break;
+            }
+            if (bytes_read == 0) {
+                remaining = 0;
+            }
+            remaining -= bytes_read;
+        }
+
+        size_t n = carry + bytes_read;
+        size_t i = 0;
+        int last_block = (remaining == 0);
+        carry = 0;
+
+        while (i < n && ret == 0) {
+            // ASCII fast path: 8 bytes per test
+            if (i + 8 <= n) {
+                uint64_t word;
+                memcpy(&word, buffer + i, sizeof(word));
+                if (!(word & ASCII_HIGH_BITS)) {
+                    for (int k = 0; k < 8; k++) {
+                        ascii_counts[buffer[i + k]]++;
+                    }
+                    i += 8;
+                    continue;
+                }
+            }
+            if (buffer[i] < 0x80) {
+                ascii_counts[buffer[i]]++;
+                i++;
+                continue;
+            }
+
+            unsigned int cp;
+            int len = utf8_decode(buffer + i, n - i, &cp);
+            if (len == 0) {
+                if (!last_block) {
+                    // truncated sequence: move it to the front and finish it after the next read
+                    carry = n - i;
+                    memmove(buffer, buffer + i, carry);
+                    break;
+                }
+                len = 1;  // the split ends inside a sequence
+            }
+            if (is_counted_code_point(cp)) {
+                ret = cp_table_add(&table, cp, 1);
+            }
+            i += len;
+        }
+    }
+
+    // Fold ASCII into the hash, then fold the hash itself if requested
+    for (int c = 0; c < 128 && ret == 0; c++) {
+        if (ascii_counts[c] && is_counted_code_point(c)) {
+            ret = cp_table_add(&table, c, ascii_counts[c]);
+        }
+    }
+    if (ret == 0 && split->usr_data) {
+        CP_TABLE folded;
+        if (cp_table_init(&folded, table.cap) < 0) {
+            ret = -1;
+        }
+        for (size_t i = 0; i < table.cap && ret == 0; i++) {
+            if (table.keys[i]) {
+                ret = cp_table_add(&folded, fold_case(table.keys[i]), table.counts[i]);
+            }
+        }
+        cp_table_free(&table);
+        table = folded;
+    }
+
+    char output_line[48];
+    for (size_t i = 0; i < table.cap && ret == 0; i++) {
+        if (table.keys[i]) {
+            int n = snprintf(output_line, sizeof(output_line), "%X %ld\n", table.keys[i], table.counts[i]);
+            if (write(fd_out, output_line, n) < 0) {
+                ret = -1;
+            }
+        }
+    }
+
+    cp_table_free(&table);
+    return ret;
+}
+
+typedef struct _cp_count
+{
+    unsigned int cp;
+    long count;
+}CP_COUNT;
+
+static int compare_code_point(const void * a, const void * b)
+{
+    unsigned int x = ((const CP_COUNT *)a)->cp, y = ((const CP_COUNT *)b)->cp;
+    return (x > y) - (x < y);
+}
+
+/* User-defined reduce function for the "Character frequency" task.
+   Merges the per-worker code point counts and writes "<character> U+<hex> <count>" lines
+   in code point order.
+   @param p_fd_in: The address of the buffer holding the intermediate data files' file descriptors.
+   @param fd_in_num: The number of the intermediate files.
+   @param fd_out: The file descriptor of the final result file.
+   @ret: 0 on success, -1 on error.
+*/
+int char_freq_reduce(int * p_fd_in, int fd_in_num, int fd_out)
+{
+    CP_TABLE table;
+    LINE_READER *reader = malloc(sizeof(LINE_READER));
+    char line[48];
+    int ret = 0;
+
+    if (!reader) {
+        return -1;
+    }
+    if (cp_table_init(&table, 1024) < 0) {
+        cp_table_free(&table);
+        free(reader);
+        return -1;
+    }
+
+    for (int i = 0; i < fd_in_num && ret == 0; i++) {
+        off_t line_start;
+        unsigned int cp;
+        long count;
+        int r;
+
+        line_reader_init(reader, p_fd_in[i], 0);
+        while (ret == 0 && (r = line_reader_next(reader, line, sizeof(line), &line_start)) > 0) {
+            if (sscanf(line, "%X %ld", &cp, &count) == 2 && cp != 0) {
+                ret = cp_table_add(&table, cp, count);
+            }
+        }
+        if (r < 0) {
+            ret = -1;
+        }
+    }
+
+    CP_COUNT *sorted = malloc((table.used + 1) * sizeof(*sorted));
+    if (!sorted) {
+        ret = -1;
+    }
+    size_t sorted_num = 0;
+    for (size_t i = 0; i < table.cap && ret == 0; i++) {
+        if (table.keys[i]) {
+            sorted[sorted_num].cp = table.keys[i];
+            sorted[sorted_num].count = table.counts[i];
+            sorted_num++;
+        }
+    }
+
+    if (ret == 0) {
+        qsort(sorted, sorted_num, sizeof(*sorted), compare_code_point);
+    }
+    for (size_t i = 0; i < sorted_num && ret == 0; i++) {
+        char output_line[64];
+        int n = utf8_encode(sorted[i].cp, output_line);
+        n += snprintf(output_line + n, sizeof(output_line) - n, " U+%04X %ld\n", sorted[i].cp, sorted[i].count);
+        if (write(fd_out, output_line, n) < 0) {
+            ret = -1;
+        }
+    }
+
+    free(sorted);
+    cp_table_free(&table);
+    free(reader);
+    return ret;
+}
+
+
+/* Writes line[0..len) followed by '\n' if the compiled regex matches it. @ret: 0 on success, -1 on error. */
+static int emit_if_regex_match(REGEX * re, const char * line, size_t len, int fd_out)
+{
+    int matched = regex_match_line(re, line, len);
+
+    if (matched < 0) {
+        return -1;
+    }
+    if (matched && (write(fd_out, line, len) < 0 || write(fd_out, "\n", 1) < 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+/* User-defined map function for the "Regex finder" task.
+   Writes every line of the split that matches the regex in split->usr_data. The regex is compiled
+   by the coordinator before the workers are forked; each worker extends its own copy of the lazy DFA.
+   Unlike word_finder_map, lines are never cut: the line buffer grows to hold the longest line, so
+   '^' and '$' only apply at real line boundaries and a matching line is written once, as grep does.
+   Matching empty lines are kept (as "\n"), so patterns such as "^$" work.
+   @param split: The data split that the map function is going to work on.
+   @param fd_out: The file descriptor of the itermediate data file output by the map function.
+   @ret: 0 on success, -1 on error.
+ */
+int regex_finder_map(DATA_SPLIT * split, int fd_out)
+{
+    size_t line_cap = MAX_LINE_LENGTH;
+    char *line = malloc(line_cap);
+    REGEX *re = (REGEX *)split->usr_data;
+    char buffer[BUFFER_SIZE];
+    ssize_t bytes_read = 0;
+    size_t pos = 0;
+    size_t remaining = split->size;
+    int ret = 0;
+
+    if (!line) {
+        return -1;
+    }
+
+    while (ret == 0 && remaining > 0 && (bytes_read = read(split->fd, buffer,
+           remaining < BUFFER_SIZE ? remaining : BUFFER_SIZE)) > 0) {
+
+        for (ssize_t i = 0; i < bytes_read && ret == 0; i++) {
+            if (buffer[i] == '\n') {
+                ret = emit_if_regex_match(re, line, pos, fd_out);
+                pos = 0;
+                continue;
+            }
+            if (pos == line_cap) {
+                char *grown = realloc(line, 2 * line_cap);
+                if (!grown) {
+                    ret = -1;
+                    break;
+                }
+                line = grown;
+                line_cap *= 2;
+            }
+            line[pos++] = buffer[i];
+        }
+
+        remaining -= bytes_read;
+    }
+
+    // Process last line if it exists
+    if (ret == 0 && pos > 0) {
+        ret = emit_if_regex_match(re, line, pos, fd_out);
+    }
+
+    free(line);
+    return (bytes_read < 0) ? -1 : ret;
+}
+
+
+/* ----- "Top-K" task: approximate heavy hitters with a Space-Saving summary ----- */
+
+#define TOPK_CAPACITY  512   /* counters per summary; any token more frequent than N / TOPK_CAPACITY is kept */
+#define TOPK_MAX_TOKEN 64    /* longer tokens are truncated */
+
+typedef struct _topk_counter
+{
+    char token[TOPK_MAX_TOKEN];
+    long count;    /* upper bound on the token's frequency */
+    long error;    /* count - error is a lower bound */
+    int heap_pos;
+    int next;      /* hash chain */
+}TOPK_COUNTER;
+
+/* Fixed-size Space-Saving summary: a min-heap on count to find the counter to evict,
+   and a chained hash on the token to find a token's counter */
+typedef struct _topk_summary
+{
+    TOPK_COUNTER counters[TOPK_CAPACITY];
+    int heap[TOPK_CAPACITY];
+    int buckets[2 * TOPK_CAPACITY];
+    int used;
+    long total;    /* number of tokens seen */
+}TOPK_SUMMARY;
+
+static unsigned int topk_token_hash(const char * token)
+{
+    unsigned int h = 2166136261u;
+    while (*token) {
+        h = (h ^ (unsigned char)*token++) * 16777619u;
+    }
+    return h;
+}
+
+static unsigned int topk_hash(const char * token)
+{
+    return topk_token_hash(token) % (2 * TOPK_CAPACITY);
+}
+
+static void topk_heap_swap(TOPK_SUMMARY * s, int a, int b)
+{
+    int tmp = s->heap[a];
+    s->heap[a] = s->heap[b];
+    s->heap[b] = tmp;
+    s->counters[s->heap[a]].heap_pos = a;
+    s->counters[s->heap[b]].heap_pos = b;
+}
+
+/* Restores the heap below pos after the counter at pos grew */
+static void topk_sift_down(TOPK_SUMMARY * s, int pos)
+{
+    for (;;) {
+        int smallest = pos, l = 2 * pos + 1, r = l + 1;
+        if (l < s->used && s->counters[s->heap[l]].count < s->counters[s->heap[smallest]].count) smallest = l;
+        if (r < s->used && s->counters[s->heap[r]].count < s->counters[s->heap[smallest]].count) smallest = r;
+        if (smallest == pos) {
+            return;
+        }
+        topk_heap_swap(s, pos, smallest);
+        pos = smallest;
+    }
+}
+
+/* Restores the heap above pos after a counter was added at pos */
+static void topk_sift_up(TOPK_SUMMARY * s, int pos)
+{
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (s->counters[s->heap[parent]].count <= s->counters[s->heap[pos]].count) {
+            return;
+        }
+        topk_heap_swap(s, pos, parent);
+        pos = parent;
+    }
+}
+
+static void topk_unlink(TOPK_SUMMARY * s, int idx)
+{
+    int * link = &s->buckets[topk_hash(s->counters[idx].token)];
+    while (*link != idx) {
+        link = &s->counters[*link].next;
+    }
+    *link = s->counters[idx].next;
+}
+
+static void topk_init(TOPK_SUMMARY * s)
+{
+    s->used = 0;
+    s->total = 0;
+    for (int i = 0; i < 2 * TOPK_CAPACITY; i++) {
+        s->buckets[i] = -1;
+    }
+}
+
+/* Counts one occurrence of token. When the summary is full the least frequent counter is taken
+   over, and the new token inherits its count as error. */
+static void topk_add(TOPK_SUMMARY * s, const char * token)
+{
+    unsigned int h = topk_hash(token);
+    int idx;
+
+    s->total++;
+    for (idx = s->buckets[h]; idx >= 0; idx = s->counters[idx].next) {
+        if (!strcmp(s->counters[idx].token, token)) {
+            s->counters[idx].count++;
+            topk_sift_down(s, s->counters[idx].heap_pos);
+            return;
+        }
+    }
+
+    TOPK_COUNTER * c;
+    if (s->used < TOPK_CAPACITY) {
+        idx = s->used++;
+        c = &s->counters[idx];
+        c->count = 1;
+        c->error = 0;
+        c->heap_pos = idx;
+        s->heap[idx] = idx;
+        topk_sift_up(s, idx);
+    }
+    else {
+        idx = s->heap[0];
+        topk_unlink(s, idx);
+        c = &s->counters[idx];
+        c->error = c->count;
+        c->count++;
+    }
+    strcpy(c->token, token);
+    c->next = s->buckets[h];
+    s->buckets[h] = idx;
+    topk_sift_down(s, c->heap_pos);
+}
+
+static TOPK_SUMMARY * topk_worker_summary = NULL;  // the map worker's summary, kept across its splits
+
+static void topk_add_token(TOPK_SUMMARY * s, char * token, size_t len, int has_alnum)
+{
+    if (len > 0 && has_alnum) {
+        token[len] = '\0';
+        topk_add(s, token);
+    }
+}
+
+/* User-defined map function for the "Top-K" task.
+   Splits the input into tokens and feeds them to the worker's Space-Saving summary of TOPK_CAPACITY
+   counters, so memory does not depend on the vocabulary size. A token is a maximal run of letters,
+   digits and non-ASCII bytes, where a single apostrophe may join two runs ("don't"); quote marks around
+   a token are dropped, and so are tokens without any ASCII letter or digit (e.g. a lone dash).
+   Nothing is written here: the summary grows over all the splits the worker maps (every chunk in
+   streaming mode) and topk_flush writes it once.
+   @param split: The data split that the map function is going to work on.
+   @param fd_out: The file descriptor of the itermediate data file output by the map function.
+   @ret: 0 on success, -1 on error.
+ */
+int topk_map(DATA_SPLIT * split, int fd_out)
+{
+    char buffer[BUFFER_SIZE];
+    char token[TOPK_MAX_TOKEN];
+    ssize_t bytes_read = 0;
+    size_t pos = 0;
+    size_t remaining = split->size;
+    int has_alnum = 0, quote_pending = 0;
+
+    if (!topk_worker_summary) {
+        topk_worker_summary = malloc(sizeof(TOPK_SUMMARY));
+        if (!topk_worker_summary) {
+            return -1;
+        }
+        topk_init(topk_worker_summary);
+    }
+    TOPK_SUMMARY *s = topk_worker_summary;
+
+    while (remaining > 0 && (bytes_read = read(split->fd, buffer,
+           remaining < BUFFER_SIZE ? remaining : BUFFER_SIZE)) > 0) {
+        for (ssize_t i = 0; i < bytes_read; i++) {
+            unsigned char c = buffer[i];
+            if (isalnum(c) || c >= 0x80) {
+                if (quote_pending && pos < TOPK_MAX_TOKEN - 1) {
+                    token[pos++] = '\'';
+                }
+                quote_pending = 0;
+                if (pos < TOPK_MAX_TOKEN - 1) {
+                    token[pos++] = c;
+                }
+                has_alnum |= (c < 0x80);
+            }
+            else if (c == '\'' && pos > 0 && !quote_pending) {
+                quote_pending = 1;  // kept only if a letter or digit follows
+            }
+            else if (pos > 0) {
+                topk_add_token(s, token, pos, has_alnum);
+                pos = 0;
+                has_alnum = quote_pending = 0;
+            }
+        }
+        remaining -= bytes_read;
+    }
+    topk_add_token(s, token, pos, has_alnum);
+
+    return (bytes_read < 0) ? -1 : 0;
+}
+
+/* Map flush function for the "Top-K" task, called once per map worker after its last split.
+   Writes the worker's summary as a header "S <k> <tokens seen> <min count> <counters used>"
+   followed by one "<count> <error> <token>" line per counter. usr_data holds K as a string.
+   @param usr_data: The job's usr_data.
+   @param fd_out: The file descriptor of the itermediate data file.
+   @ret: 0 on success, -1 on error.
+ */
+int topk_flush(void * usr_data, int fd_out)
+{
+    TOPK_SUMMARY *s = topk_worker_summary;
+    int ret = 0;
+
+    if (!s) {  // the worker mapped no data
+        s = topk_worker_summary = malloc(sizeof(TOPK_SUMMARY));
+        if (!s) {
+            return -1;
+        }
+        topk_init(s);
+    }
+
+    char output_line[TOPK_MAX_TOKEN + 64];
+    long min_count = s->used == TOPK_CAPACITY ? s->counters[s->heap[0]].count : 0;
+    int n = snprintf(output_line, sizeof(output_line), "S %d %ld %ld %d\n",
+                     atoi((char *)usr_data), s->total, min_count, s->used);
+    if (write(fd_out, output_line, n) < 0) {
+        ret = -1;
+    }
+    for (int i = 0; i < s->used && ret == 0; i++) {
+        n = snprintf(output_line, sizeof(output_line), "%ld %ld %s\n",
+                     s->counters[i].count, s->counters[i].error, s->counters[i].token);
+        if (write(fd_out, output_line, n) < 0) {
+            ret = -1;
+        }
+    }
+
+    free(s);
+    topk_worker_summary = NULL;
+    return ret;
+}
+
+/* A token in the merged summary; min_seen sums the min counts of the summaries that had it */
+typedef struct _topk_entry
+{
+    char token[TOPK_MAX_TOKEN];
+    long count;
+    long error;
+    long min_seen;
+}TOPK_ENTRY;
+
+static int compare_topk_entry(const void * a, const void * b)
+{
+    const TOPK_ENTRY *x = a, *y = b;
+    if (x->count != y->count) {
+        return (x->count < y->count) - (x->count > y->count);  // descending count
+    }
+    return strcmp(x->token, y->token);
+}
+
+/* User-defined reduce function for the "Top-K" task.
+   Merges the Space-Saving summaries: counts and errors of the same token are added, and a token missing
+   from a full summary may have occurred up to that summary's min count times there, so that min count is
+   added to both its count and its error. Writes the K most frequent tokens as
+   "<token> <count> <error>"; the token's true frequency lies in [count - error, count].
+   @param p_fd_in: The address of the buffer holding the intermediate data files' file descriptors.
+   @param fd_in_num: The number of the intermediate files.
+   @param fd_out: The file descriptor of the final result file.
+   @ret: 0 on success, -1 on error.
+*/
+int topk_reduce(int * p_fd_in, int fd_in_num, int fd_out)
+{
+    LINE_READER *reader = malloc(sizeof(LINE_READER));
+    TOPK_ENTRY *entries = NULL;
+    int entry_num = 0, entry_cap = 0;
+    int *buckets = NULL, *chain = NULL;   // token hash over entries, grown with them
+    char line[TOPK_MAX_TOKEN + 64];
+    long min_total = 0;                   // min_total: sum of the min counts of all full summaries
+    int k = 10;
+    int ret = 0;
+
+    if (!reader) {
+        return -1;
+    }
+
+    for (int i = 0; i < fd_in_num && ret == 0; i++) {
+        off_t line_start;
+        long summary_min = 0;
+        int r;
+
+        line_reader_init(reader, p_fd_in[i], 0);
+        while (ret == 0 && (r = line_reader_next(reader, line, sizeof(line), &line_start)) > 0) {
+            long count, error, seen;
+            int used, token_pos;
+
+            if (line[0] == 'S') {
+                if (sscanf(line, "S %d %ld %ld %d", &k, &seen, &summary_min, &used) != 4) {
+                    ret = -1;
+                }
+                min_total += summary_min;
+                continue;
+            }
+            if (sscanf(line, "%ld %ld %n", &count, &error, &token_pos) != 2) {
+                ret = -1;
+                break;
+            }
+            const char *token = line + token_pos;
+
+            if (entry_num == entry_cap) {
+                entry_cap = entry_cap ? entry_cap * 2 : 4 * TOPK_CAPACITY;
+                TOPK_ENTRY *grown = realloc(entries, entry_cap * sizeof(*entries));
+                int *grown_chain = realloc(chain, entry_cap * sizeof(*chain));
+                free(buckets);
+                buckets = malloc(2 * entry_cap * sizeof(*buckets));
+                if (grown) entries = grown;
+                if (grown_chain) chain = grown_chain;
+                if (!grown || !grown_chain || !buckets) {
+                    ret = -1;
+                    break;
+                }
+                // rehash the existing entries into the bigger table
+                for (int b = 0; b < 2 * entry_cap; b++) buckets[b] = -1;
+                for (int e = 0; e < entry_num; e++) {
+                    unsigned int h = topk_token_hash(entries[e].token) % (2 * entry_cap);
+                    chain[e] = buckets[h];
+                    buckets[h] = e;
+                }
+            }
+
+            unsigned int h = topk_token_hash(token) % (2 * entry_cap);
+            int e;
+            for (e = buckets[h]; e >= 0; e = chain[e]) {
+                if (!strcmp(entries[e].token, token)) {
+                    break;
+                }
+            }
+            if (e < 0) {
+                e = entry_num++;
+                snprintf(entries[e].token, TOPK_MAX_TOKEN, "%s", token);
+                entries[e].count = entries[e].error = entries[e].min_seen = 0;
+                chain[e] = buckets[h];
+                buckets[h] = e;
+            }
+            entries[e].count += count;
+            entries[e].error += error;
+            entries[e].min_seen += summary_min;
+        }
+        if (r < 0) {
+            ret = -1;
+        }
+    }
+
+    if (ret == 0) {
+        for (int e = 0; e < entry_num; e++) {
+            long absent_min = min_total - entries[e].min_seen;
+            entries[e].count += absent_min;
+            entries[e].error += absent_min;
+        }
+        qsort(entries, entry_num, sizeof(*entries), compare_topk_entry);
+
+        char output_line[TOPK_MAX_TOKEN + 64];
+        for (int e = 0; e < entry_num && e < k && ret == 0; e++) {
+            int n = snprintf(output_line, sizeof(output_line), "%s %ld %ld\n",
+                             entries[e].token, entries[e].count, entries[e].error);
+            if (write(fd_out, output_line, n) < 0) {
+                ret = -1;
+            }
+        }
+    }
+
+    free(buckets);
+    free(chain);
+    free(entries);
+    free(reader);
+    return ret;
+}
+
+/* User-defined reduce function for the "Regex finder" task.
+   Unlike word_finder_reduce, every matching line is kept, including empty lines and repeated lines,
+   in the order of the intermediate files, so the result is what "grep" prints for the pattern.
+   @param p_fd_in: The address of the buffer holding the intermediate data files' file descriptors.
+   @param fd_in_num: The number of the intermediate files.
+   @param fd_out: The file descriptor of the final result file.
+   @ret: 0 on success, -1 on error.
+*/
+int regex_finder_reduce(int * p_fd_in, int fd_in_num, int fd_out)
+{
+    char buffer[BUFFER_SIZE];
+
+    for (int i = 0; i < fd_in_num; i++) {
+        ssize_t bytes_read;
+
+        lseek(p_fd_in[i], 0, SEEK_SET);
+        while ((bytes_read = read(p_fd_in[i], buffer, BUFFER_SIZE)) > 0) {
+            if (write(fd_out, buffer, bytes_read) != bytes_read) {
+                return -1;
+            }
+        }
+        if (bytes_read < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
\ No newline at end of file
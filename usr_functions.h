@@ -5,6 +5,10 @@
 
 #include "mapreduce.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 
 int letter_counter_map(DATA_SPLIT * split, int fd_out);
 int letter_counter_reduce(int * p_fd_in, int fd_in_num, int fd_out);
@@ -12,5 +16,22 @@ int letter_counter_reduce(int * p_fd_in, int fd_in_num, int fd_out);
 int word_finder_map(DATA_SPLIT * split, int fd_out);
 int word_finder_reduce(int * p_fd_in, int fd_in_num, int fd_out);
 
+int word_finder_annotated_map(DATA_SPLIT * split, int fd_out);
+int word_finder_annotated_reduce(int * p_fd_in, int fd_in_num, int fd_out);
+
+int char_freq_map(DATA_SPLIT * split, int fd_out);
+int char_freq_reduce(int * p_fd_in, int fd_in_num, int fd_out);
+
+int regex_finder_map(DATA_SPLIT * split, int fd_out);
+int regex_finder_reduce(int * p_fd_in, int fd_in_num, int fd_out);
+
+int topk_map(DATA_SPLIT * split, int fd_out);
+int topk_flush(void * usr_data, int fd_out);
+int topk_reduce(int * p_fd_in, int fd_in_num, int fd_out);
+
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
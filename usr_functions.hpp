@@ -0,0 +1,62 @@
+/* Typed versions of the user jobs for the C++ layer in mapreduce.hpp */
+
+#ifndef _USR_FUNCTIONS_HPP
+#define _USR_FUNCTIONS_HPP
+
+#include <string>
+#include "mapreduce.hpp"
+
+/* "Letter counter": 26 fixed keys, so every worker keeps a std::array<long, 26> and ships 26 longs */
+struct LetterCounterMapper
+{
+    static constexpr std::size_t key_count = 26;
+
+    template <class Emit>
+    void operator()(const char * begin, const char * end, Emit && emit) const
+    {
+        for (const char * p = begin; p < end; p++) {
+            unsigned int k = ((unsigned char)*p | 0x20) - 'a';  // folds case, maps letters to 0..25
+            if (k < 26) {
+                emit(k, 1L);
+            }
+        }
+    }
+};
+
+typedef mr::MapReduce<LetterCounterMapper, mr::Sum<long>, unsigned int, long> LetterCounter;
+
+/* "Word counter": words are maximal runs of letters and digits, joined by single apostrophes
+   ("don't", "o'clock"); quote marks before or after a word are not part of it */
+struct WordCounterMapper
+{
+    template <class Emit>
+    void operator()(const char * begin, const char * end, Emit && emit) const
+    {
+        const char * p = begin;
+        while (p < end) {
+            while (p < end && !is_alnum(*p)) p++;
+            const char * word = p;
+            for (;;) {
+                while (p < end && is_alnum(*p)) p++;
+                if (p + 1 < end && *p == '\'' && is_alnum(p[1])) {
+                    p++;
+                    continue;
+                }
+                break;
+            }
+            if (p > word) {
+                emit(std::string(word, p - word), 1L);
+            }
+        }
+    }
+
+    static bool is_alnum(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+    }
+};
+
+typedef mr::MapReduce<WordCounterMapper, mr::Sum<long>, std::string, long> WordCounter;
+
+
+#endif